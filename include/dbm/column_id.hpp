@@ -0,0 +1,150 @@
+#ifndef DBM_COLUMN_ID_HPP
+#define DBM_COLUMN_ID_HPP
+
+#include <dbm/detail/utils.hpp>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dbm::kind {
+
+/**
+ * Interned column name
+ *
+ * Equal names map to the same small integer (process wide), so sql rows field names and
+ * model keys can be matched by an integer compare instead of hashing strings.
+ * Interned names are never released, so only model keys and names of explicitly
+ * requested columns are interned - sql rows only look up their field names.
+ */
+class column_id
+{
+public:
+    static constexpr uint32_t invalid = ~uint32_t(0);
+
+    column_id() = default;
+
+    explicit column_id(std::string_view name)
+        : id_(intern(name))
+    {}
+
+    /**
+     * Ids of names (invalid for names never interned) looked up under a single lock
+     *
+     * n_interned is set to the number of names interned so far - ids of names
+     * interned later are not lower.
+     */
+    static std::vector<column_id> find(std::vector<std::string> const& names, uint32_t& n_interned);
+
+    uint32_t value() const noexcept { return id_; }
+
+    bool valid() const noexcept { return id_ != invalid; }
+
+    std::string const& name() const;
+
+    bool operator==(column_id oth) const noexcept { return id_ == oth.id_; }
+
+    bool operator!=(column_id oth) const noexcept { return id_ != oth.id_; }
+
+    bool operator<(column_id oth) const noexcept { return id_ < oth.id_; }
+
+private:
+    struct registry
+    {
+        std::shared_mutex mtx;
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::deque<std::string> names; // stable addresses for ids keys
+    };
+
+    static registry& get_registry();
+
+    static uint32_t intern(std::string_view name);
+
+    explicit column_id(uint32_t id) noexcept
+        : id_(id)
+    {}
+
+    uint32_t id_ {invalid};
+};
+
+DBM_INLINE std::string const& column_id::name() const
+{
+    if (!valid())
+        throw_exception<std::domain_error>("Invalid column id");
+
+    auto& r = get_registry();
+    std::shared_lock lock(r.mtx);
+    return r.names[id_];
+}
+
+DBM_INLINE std::vector<column_id> column_id::find(std::vector<std::string> const& names, uint32_t& n_interned)
+{
+    std::vector<column_id> ids;
+    ids.reserve(names.size());
+
+    auto& r = get_registry();
+    std::shared_lock lock(r.mtx);
+    n_interned = static_cast<uint32_t>(r.names.size());
+    for (auto const& name : names) {
+        auto it = r.ids.find(name);
+        ids.push_back(it != r.ids.end() ? column_id(it->second) : column_id());
+    }
+    return ids;
+}
+
+DBM_INLINE column_id::registry& column_id::get_registry()
+{
+    static registry r;
+    return r;
+}
+
+DBM_INLINE uint32_t column_id::intern(std::string_view name)
+{
+    auto& r = get_registry();
+    {
+        std::shared_lock lock(r.mtx);
+        auto it = r.ids.find(name);
+        if (it != r.ids.end())
+            return it->second;
+    }
+
+    std::unique_lock lock(r.mtx);
+    auto it = r.ids.find(name);
+    if (it != r.ids.end())
+        return it->second;
+
+    auto id = static_cast<uint32_t>(r.names.size());
+    r.ids.emplace(r.names.emplace_back(name), id);
+    return id;
+}
+
+/**
+ * Column handle
+ *
+ * Resolved column index in sql rows (see sql_rows::column()). Valid for all rows with
+ * the same field names.
+ */
+class sql_column
+{
+public:
+    sql_column() = default;
+
+    explicit sql_column(size_t index, column_id id = {}) noexcept
+        : index_(index)
+        , id_(id)
+    {}
+
+    size_t index() const noexcept { return index_; }
+
+    column_id id() const noexcept { return id_; }
+
+private:
+    size_t index_ {0};
+    column_id id_;
+};
+
+} // namespace dbm::kind
+
+#endif //DBM_COLUMN_ID_HPP
@@ -0,0 +1,94 @@
+#ifndef DBM_CORO_HPP
+#define DBM_CORO_HPP
+
+#ifdef DBM_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <type_traits>
+
+namespace dbm {
+
+/*!
+ * Executor used by coroutine operations to run blocking database calls.
+ * The executor receives a job which must be invoked exactly once on any thread.
+ */
+using coro_executor = std::function<void(std::function<void()>)>;
+
+namespace detail {
+
+/*!
+ * Awaitable blocking operation
+ *
+ * If the executor is set the operation is posted to the executor and the awaiting
+ * coroutine is resumed from the executor thread once finished. Without executor the
+ * operation is performed in place without suspending, blocking the awaiting thread.
+ */
+template<typename Fn>
+class coro_operation
+{
+public:
+    using result_type = std::invoke_result_t<Fn>;
+
+    coro_operation(coro_executor executor, Fn&& fn)
+        : executor_(std::move(executor))
+        , fn_(std::move(fn))
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return !executor_;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        // the awaiter is destroyed once the coroutine resumes, possibly before the executor returns
+        auto executor = executor_;
+        executor([this, h] {
+            try {
+                if constexpr (std::is_void_v<result_type>) {
+                    fn_();
+                }
+                else {
+                    result_.emplace(fn_());
+                }
+            }
+            catch (...) {
+                error_ = std::current_exception();
+            }
+            h.resume();
+        });
+    }
+
+    result_type await_resume()
+    {
+        if (!executor_) {
+            return fn_();
+        }
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+
+        if constexpr (!std::is_void_v<result_type>) {
+            return std::move(*result_);
+        }
+    }
+
+private:
+    using storage_type = std::conditional_t<std::is_void_v<result_type>, bool, result_type>;
+
+    coro_executor executor_;
+    Fn fn_;
+    std::optional<storage_type> result_;
+    std::exception_ptr error_;
+};
+
+} // namespace detail
+} // namespace dbm
+
+#endif //DBM_COROUTINES
+
+#endif //DBM_CORO_HPP
@@ -6,6 +6,7 @@
 #include <dbm/model_item.hpp>
 #include <dbm/model.hpp>
 #include <dbm/session.hpp>
+#include <dbm/identity_cache.hpp>
 #include <dbm/prepared_statement.hpp>
 #include <dbm/pool.hpp>
 #include <dbm/impl/model_item.ipp>
@@ -40,6 +41,8 @@ using timestamp2u_converter = kind::detail::timestamp2u_converter;
 using sql_row = kind::sql_row;
 using sql_rows = kind::sql_rows;
 using sql_rows_dump = kind::sql_rows_dump;
+using sql_result = kind::sql_result;
+using sql_results = kind::sql_results;
 
 using statement = detail::statement;
 
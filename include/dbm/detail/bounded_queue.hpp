@@ -0,0 +1,144 @@
+#ifndef DBM_BOUNDED_QUEUE_HPP
+#define DBM_BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace dbm::detail {
+
+/*!
+ * Bounded lock-free queue (many producers, many consumers)
+ *
+ * Ring buffer where every cell carries a sequence number telling whether it is free for the
+ * producer or filled for the consumer. Push fails when the queue is full, it never blocks
+ * or allocates. Capacity is rounded up to a power of two.
+ */
+template<typename T>
+class bounded_queue
+{
+public:
+    explicit bounded_queue(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity) {
+            n <<= 1;
+        }
+
+        mask_ = n - 1;
+        cells_ = std::make_unique<cell[]>(n);
+        for (size_t i = 0; i < n; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bounded_queue(bounded_queue const&) = delete;
+
+    bounded_queue& operator=(bounded_queue const&) = delete;
+
+    bool try_push(T const& value)
+    {
+        return push(value);
+    }
+
+    /*!
+     * Moves value into the queue (value is left untouched if the queue is full)
+     */
+    bool try_push(T&& value)
+    {
+        return push(std::move(value));
+    }
+
+    bool try_pop(T& value)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto& c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(c.value);
+                    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // empty
+            }
+            else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /*!
+     * True if no value is ready to be popped (approximate while others push or pop)
+     */
+    bool empty() const
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_acquire);
+        size_t seq = cells_[pos & mask_].seq.load(std::memory_order_acquire);
+        return static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0;
+    }
+
+    /*!
+     * Number of queued values (approximate while others push or pop)
+     */
+    size_t size() const
+    {
+        size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t enq = enqueue_pos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+private:
+    template<typename U>
+    bool push(U&& value)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto& c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = std::forward<U>(value);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // full
+            }
+            else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    struct cell
+    {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<cell[]> cells_;
+    size_t mask_ {0};
+    alignas(64) std::atomic<size_t> enqueue_pos_ {0};
+    alignas(64) std::atomic<size_t> dequeue_pos_ {0};
+};
+
+} // namespace dbm::detail
+
+#endif //DBM_BOUNDED_QUEUE_HPP
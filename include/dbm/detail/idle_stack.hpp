@@ -0,0 +1,188 @@
+#ifndef DBM_IDLE_STACK_HPP
+#define DBM_IDLE_STACK_HPP
+
+#include <dbm/detail/utils.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace dbm::detail {
+
+/*!
+ * Lock-free LIFO stack of object pointers
+ *
+ * Objects are attached to a slot once and are then pushed and popped by slot id.
+ * Push and pop only touch atomics. Slots are stored in chunks which are never freed
+ * while the stack exists, so a concurrent pop never reads released memory, and the
+ * head carries a tag which protects against ABA.
+ *
+ * attach and detach take a mutex and are expected to be rare (connection created
+ * or closed).
+ *
+ * A slot may also be taken from the middle of the stack (take). It is only marked as taken
+ * and stays linked until pop reaches and skips it; pushing it before that marks it back.
+ * A detached slot may remain linked only in the taken state, pop skips it as well.
+ */
+template<typename T>
+class idle_stack
+{
+public:
+    using slot_id = uint32_t;
+
+    idle_stack() = default;
+
+    idle_stack(idle_stack const&) = delete;
+
+    idle_stack& operator=(idle_stack const&) = delete;
+
+    ~idle_stack()
+    {
+        for (auto& c : chunks_) {
+            delete[] c.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot_id attach(T* value)
+    {
+        std::lock_guard lock(mtx_);
+
+        slot_id id;
+        if (!free_slots_.empty()) {
+            id = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        else {
+            if (n_slots_ == chunk_size * max_chunks)
+                throw_exception<std::length_error>("idle_stack capacity exceeded");
+            id = n_slots_++;
+            auto& c = chunks_[id / chunk_size];
+            if (!c.load(std::memory_order_relaxed))
+                c.store(new slot[chunk_size], std::memory_order_release);
+        }
+
+        at(id).value = value;
+        return id;
+    }
+
+    void detach(slot_id id)
+    {
+        std::lock_guard lock(mtx_);
+        at(id).value = nullptr;
+        free_slots_.push_back(id);
+    }
+
+    void push(slot_id id)
+    {
+        auto& s = at(id);
+
+        // taken slot which is still linked
+        uint8_t state = taken;
+        if (s.state.compare_exchange_strong(state, linked)) {
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        s.state.store(linked);
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t new_head;
+
+        do {
+            s.next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            new_head = next_tag(head) | (uint64_t(id) + 1);
+        } while (!head_.compare_exchange_weak(head, new_head, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    T* pop()
+    {
+        uint64_t head = head_.load(std::memory_order_seq_cst);
+
+        while (static_cast<uint32_t>(head)) {
+            auto& s = at(static_cast<uint32_t>(head) - 1);
+            uint64_t new_head = next_tag(head) | s.next.load(std::memory_order_relaxed);
+
+            if (head_.compare_exchange_weak(head, new_head, std::memory_order_seq_cst, std::memory_order_seq_cst)) {
+                // unlinked - skip the slot if it was taken meanwhile (unless pushed back)
+                uint8_t state = s.state.load();
+                while (!s.state.compare_exchange_weak(state, unlinked)) {
+                }
+
+                if (state == linked) {
+                    size_.fetch_sub(1, std::memory_order_relaxed);
+                    return s.value;
+                }
+
+                head = head_.load(std::memory_order_seq_cst);
+            }
+        }
+
+        return nullptr;
+    }
+
+    /*!
+     * Takes the slot if it is on the stack
+     */
+    T* take(slot_id id)
+    {
+        auto& s = at(id);
+
+        uint8_t state = linked;
+        if (!s.state.compare_exchange_strong(state, taken))
+            return nullptr;
+
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return s.value;
+    }
+
+    size_t size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return static_cast<uint32_t>(head_.load(std::memory_order_seq_cst)) == 0;
+    }
+
+private:
+    static constexpr slot_id chunk_size = 64;
+    static constexpr slot_id max_chunks = 1024;
+
+    enum : uint8_t
+    {
+        unlinked,
+        linked,
+        taken,  // linked, but no longer on the stack
+    };
+
+    struct slot
+    {
+        std::atomic<uint32_t> next {0};     // next slot id + 1 (0 - end of stack)
+        std::atomic<uint8_t> state {unlinked};
+        T* value {nullptr};
+    };
+
+    static uint64_t next_tag(uint64_t head)
+    {
+        return ((head >> 32) + 1) << 32;
+    }
+
+    slot& at(slot_id id) const
+    {
+        return chunks_[id / chunk_size].load(std::memory_order_acquire)[id % chunk_size];
+    }
+
+    std::atomic<uint64_t> head_ {0};        // tag (high 32 bits) | top slot id + 1 (low 32 bits)
+    std::atomic<size_t> size_ {0};
+    std::array<std::atomic<slot*>, max_chunks> chunks_ {};
+    std::vector<slot_id> free_slots_;
+    slot_id n_slots_ {0};
+    std::mutex mtx_;                        // mutex protecting slot allocation
+};
+
+} // namespace dbm::detail
+
+#endif //DBM_IDLE_STACK_HPP
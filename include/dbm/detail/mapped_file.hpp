@@ -0,0 +1,103 @@
+#ifndef DBM_MAPPED_FILE_HPP
+#define DBM_MAPPED_FILE_HPP
+
+#include <dbm/detail/utils.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dbm::utils {
+
+/**
+ * Read-only memory mapped file
+ *
+ * Pages are loaded on first access. On platforms without mmap support the file
+ * content is read into memory.
+ */
+class mapped_file
+{
+public:
+    explicit mapped_file(std::string const& path);
+
+    mapped_file(mapped_file const&) = delete;
+
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    ~mapped_file();
+
+    char const* data() const noexcept { return data_; }
+
+    size_t size() const noexcept { return size_; }
+
+private:
+    char const* data_ {nullptr};
+    size_t size_ {0};
+#ifdef _WIN32
+    std::vector<char> buffer_;
+#endif
+};
+
+#ifdef _WIN32
+
+DBM_INLINE mapped_file::mapped_file(std::string const& path)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f)
+        throw_exception<std::runtime_error>("Cannot open file " + path);
+
+    buffer_.resize(static_cast<size_t>(f.tellg()));
+    f.seekg(0);
+    if (!f.read(buffer_.data(), buffer_.size()))
+        throw_exception<std::runtime_error>("Cannot read file " + path);
+
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+DBM_INLINE mapped_file::~mapped_file() = default;
+
+#else
+
+DBM_INLINE mapped_file::mapped_file(std::string const& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw_exception<std::runtime_error>("Cannot open file " + path);
+
+    execute_at_exit close_fd([fd] { ::close(fd); });
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0)
+        throw_exception<std::runtime_error>("Cannot stat file " + path);
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0)
+        return;
+
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+        throw_exception<std::runtime_error>("Cannot map file " + path);
+
+    data_ = static_cast<char const*>(p);
+}
+
+DBM_INLINE mapped_file::~mapped_file()
+{
+    if (data_)
+        ::munmap(const_cast<char*>(data_), size_);
+}
+
+#endif
+
+} // namespace dbm::utils
+
+#endif //DBM_MAPPED_FILE_HPP
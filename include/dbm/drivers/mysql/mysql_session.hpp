@@ -25,9 +25,22 @@ public:
         std::optional<std::string_view> unix_socket = std::nullopt,
         unsigned long client_flag = 0);
 
+    /*!
+     * Executes several ';' separated statements in one round-trip (multi statements
+     * are enabled on the connection for this call only) and returns each statement result in order.
+     * Result set rows own their MySQL result and remain valid after the next query.
+     */
+    kind::sql_results select_multi(std::string_view statements);
+
+    /*!
+     * Same as select_multi but each result is passed to the handler as soon as it is retrieved
+     */
+    void query_multi(std::string_view statements, std::function<void(kind::sql_result&)> const& handler);
+
 private:
     void close_impl();
     bool is_connected_impl() const { return conn_ != nullptr; }
+    bool ping_impl();
 
     void query_impl(std::string_view statement);
     void init_prepared_statement_impl(kind::prepared_statement& stmt);
@@ -45,11 +58,14 @@ private:
     void transaction_rollback_impl();
 
     kind::sql_rows select_rows_impl(std::string_view statement);
+    kind::sql_rows fetch_rows(void* res);
+    bool enable_multi_statements();
+    void disable_multi_statements();
     void free_result_set();
     std::string last_mysql_error() const;
 
     void* conn_{nullptr};    /* connection handler pointer */
-    void* res_set_{nullptr}; /* mysql result set */
+    bool multi_statements_{false};   /* connected with CLIENT_MULTI_STATEMENTS */
 };
 
 }// namespace dbm
@@ -0,0 +1,204 @@
+#ifndef DBM_SQLITE_POOL_HPP
+#define DBM_SQLITE_POOL_HPP
+
+#include <dbm/drivers/sqlite/sqlite_session.hpp>
+#include <dbm/pool.hpp>
+#include <algorithm>
+#include <thread>
+
+namespace dbm {
+
+/*!
+ * SQLite single writer / multi reader pool
+ *
+ * All writes go through one dedicated writer connection (concurrent writers are queued
+ * by the writer pool) while reads are served by up to N query-only reader connections.
+ * The database is switched to WAL journal mode so readers never block the writer
+ * and the writer never blocks readers.
+ */
+class DBM_EXPORT sqlite_pool
+{
+public:
+    struct session_factory
+    {
+        std::shared_ptr<sqlite_session> operator()();
+
+        std::string db_file_name;
+        sqlite_options options;
+    };
+
+    using pool_type = pool<sqlite_session, session_factory>;
+    using pool_connection_type = pool_type::pool_connection_type;
+
+    explicit sqlite_pool(std::string db_file_name,
+                         size_t n_readers = std::max(1u, std::thread::hardware_concurrency()),
+                         sqlite_options opts = sqlite_options::read_heavy());
+
+    sqlite_pool(sqlite_pool const&) = delete;
+
+    sqlite_pool& operator=(sqlite_pool const&) = delete;
+
+    pool_connection_type acquire_writer() { return writer_.acquire(); }
+
+    pool_connection_type acquire_reader() { return readers_.acquire(); }
+
+    pool_type& writer_pool() noexcept { return writer_; }
+
+    pool_type& reader_pool() noexcept { return readers_; }
+
+    void set_acquire_timeout(std::chrono::milliseconds to);
+
+    /*!
+     * Sets result cache shared by reader and writer connections (nullptr disables caching)
+     */
+    void set_query_cache(std::shared_ptr<query_cache> cache);
+
+    std::shared_ptr<query_cache> get_query_cache() const { return readers_.get_query_cache(); }
+
+    /*!
+     * Sets primary key identity cache shared by reader and writer connections (nullptr disables caching)
+     */
+    void set_identity_cache(std::shared_ptr<identity_cache> cache);
+
+    std::shared_ptr<identity_cache> get_identity_cache() const { return readers_.get_identity_cache(); }
+
+    // Writes - performed on the writer connection
+    void query(std::string_view statement);
+
+    void query(kind::prepared_statement& stmt);
+
+    template<typename Model>
+    void write_record(Model& m);
+
+    template<typename Model>
+    void delete_record(Model& m);
+
+    // Reads - performed on a reader connection
+    kind::sql_rows select(std::string_view statement);
+
+    std::vector<std::vector<container_ptr>> select(kind::prepared_statement& stmt);
+
+    template<typename Model>
+    void read_record(Model& m, const std::string& extra_condition = "");
+
+private:
+    static sqlite_options writer_options(sqlite_options opts);
+    static sqlite_options reader_options(sqlite_options opts);
+    static void init_statement(sqlite_session& s, kind::prepared_statement& stmt);
+
+    pool_type writer_;
+    pool_type readers_;
+};
+
+DBM_INLINE std::shared_ptr<sqlite_session> sqlite_pool::session_factory::operator()()
+{
+    auto conn = std::make_shared<sqlite_session>();
+    conn->connect(db_file_name, options);
+    return conn;
+}
+
+DBM_INLINE sqlite_pool::sqlite_pool(std::string db_file_name, size_t n_readers, sqlite_options opts)
+    : writer_(session_factory {db_file_name, writer_options(opts)})
+    , readers_(session_factory {std::move(db_file_name), reader_options(std::move(opts))})
+{
+    writer_.set_max_connections(1);
+    readers_.set_max_connections(n_readers);
+
+    // open the writer first so the database exists and is switched to WAL before readers connect
+    writer_.acquire();
+}
+
+DBM_INLINE void sqlite_pool::set_acquire_timeout(std::chrono::milliseconds to)
+{
+    writer_.set_acquire_timeout(to);
+    readers_.set_acquire_timeout(to);
+}
+
+DBM_INLINE void sqlite_pool::set_query_cache(std::shared_ptr<query_cache> cache)
+{
+    writer_.set_query_cache(cache);
+    readers_.set_query_cache(std::move(cache));
+}
+
+DBM_INLINE void sqlite_pool::set_identity_cache(std::shared_ptr<identity_cache> cache)
+{
+    writer_.set_identity_cache(cache);
+    readers_.set_identity_cache(std::move(cache));
+}
+
+DBM_INLINE void sqlite_pool::query(std::string_view statement)
+{
+    writer_.acquire().get().query(statement);
+}
+
+DBM_INLINE void sqlite_pool::query(kind::prepared_statement& stmt)
+{
+    auto conn = writer_.acquire();
+    init_statement(conn.get(), stmt);
+    conn.get().query(stmt);
+}
+
+template<typename Model>
+DBM_INLINE void sqlite_pool::write_record(Model& m)
+{
+    auto conn = writer_.acquire();
+    m.write_record(conn.get());
+}
+
+template<typename Model>
+DBM_INLINE void sqlite_pool::delete_record(Model& m)
+{
+    auto conn = writer_.acquire();
+    m.delete_record(conn.get());
+}
+
+DBM_INLINE kind::sql_rows sqlite_pool::select(std::string_view statement)
+{
+    // rows own the result table so they remain valid after the reader is released
+    auto conn = readers_.acquire();
+    return conn.get().select(statement);
+}
+
+DBM_INLINE std::vector<std::vector<container_ptr>> sqlite_pool::select(kind::prepared_statement& stmt)
+{
+    auto conn = readers_.acquire();
+    init_statement(conn.get(), stmt);
+    return conn.get().select(stmt);
+}
+
+template<typename Model>
+DBM_INLINE void sqlite_pool::read_record(Model& m, const std::string& extra_condition)
+{
+    auto conn = readers_.acquire();
+    m.read_record(conn.get(), extra_condition);
+}
+
+DBM_INLINE sqlite_options sqlite_pool::writer_options(sqlite_options opts)
+{
+    opts.read_only = false;
+    opts.query_only = false;
+    opts.journal_mode = sqlite_options::journal_mode::wal;
+    return opts;
+}
+
+DBM_INLINE sqlite_options sqlite_pool::reader_options(sqlite_options opts)
+{
+    // journal mode is persistent and already set by the writer
+    opts.journal_mode = std::nullopt;
+    opts.query_only = true;
+    opts.create = false;
+    return opts;
+}
+
+DBM_INLINE void sqlite_pool::init_statement(sqlite_session& s, kind::prepared_statement& stmt)
+{
+    // handle of a statement without slot was prepared by the session that ran it last
+    if (stmt.slot() == kind::prepared_statement::no_slot) {
+        kind::prepared_statement_manipulator(stmt).set_native_handle(nullptr);
+        s.init_prepared_statement(stmt);
+    }
+}
+
+} // namespace dbm
+
+#endif //DBM_SQLITE_POOL_HPP
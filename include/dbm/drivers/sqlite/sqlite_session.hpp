@@ -2,11 +2,109 @@
 #define DBM_SQLITE_SESSION_HPP
 
 #include <dbm/session.hpp>
+#include <chrono>
+#include <optional>
 
 struct sqlite3;
 
 namespace dbm {
 
+/*!
+ * SQLite connection options
+ *
+ * Unset optional values leave the SQLite defaults in place.
+ */
+struct DBM_EXPORT sqlite_options
+{
+    enum class threading_mode
+    {
+        defaults,       /* library compile/start time setting (serialized by default) */
+        multi_thread,   /* SQLITE_OPEN_NOMUTEX - connection must not be used by more than one thread at a time */
+        serialized,     /* SQLITE_OPEN_FULLMUTEX */
+    };
+
+    enum class journal_mode
+    {
+        del,
+        truncate,
+        persist,
+        memory,
+        wal,
+        off,
+    };
+
+    enum class synchronous
+    {
+        off,
+        normal,
+        full,
+        extra,
+    };
+
+    enum class temp_store
+    {
+        defaults,
+        file,
+        memory,
+    };
+
+    bool read_only {false};
+    bool create {true};
+    bool uri {false};                           /* interpret file name as URI (file:...) */
+    bool query_only {false};                    /* PRAGMA query_only - prevents data changes on a read-write connection */
+    threading_mode threading {threading_mode::defaults};
+    std::optional<enum journal_mode> journal_mode;
+    std::optional<enum synchronous> synchronous;
+    std::optional<int64_t> mmap_size;           /* bytes */
+    std::optional<int> cache_size;              /* pages if positive, KiB if negative */
+    std::optional<enum temp_store> temp_store;
+    std::optional<std::chrono::milliseconds> busy_timeout;
+    std::function<bool(int)> busy_handler;      /* called with number of retries, return false to give up (overrides busy_timeout) */
+
+    // Concurrent readers: WAL, relaxed fsync, large page cache and memory mapped I/O
+    static sqlite_options read_heavy();
+
+    // Single writer loading a lot of data: no fsync, in-memory journal and temp store, large page cache
+    static sqlite_options bulk_load();
+
+    // Every committed transaction survives power loss: WAL with full fsync
+    static sqlite_options durable();
+};
+
+DBM_INLINE sqlite_options sqlite_options::read_heavy()
+{
+    sqlite_options opts;
+    opts.threading = threading_mode::multi_thread;
+    opts.journal_mode = journal_mode::wal;
+    opts.synchronous = synchronous::normal;
+    opts.mmap_size = 256ll * 1024 * 1024;
+    opts.cache_size = -64 * 1024;
+    opts.temp_store = temp_store::memory;
+    opts.busy_timeout = std::chrono::milliseconds(5000);
+    return opts;
+}
+
+DBM_INLINE sqlite_options sqlite_options::bulk_load()
+{
+    sqlite_options opts;
+    opts.threading = threading_mode::multi_thread;
+    opts.journal_mode = journal_mode::memory;
+    opts.synchronous = synchronous::off;
+    opts.cache_size = -256 * 1024;
+    opts.temp_store = temp_store::memory;
+    opts.busy_timeout = std::chrono::milliseconds(5000);
+    return opts;
+}
+
+DBM_INLINE sqlite_options sqlite_options::durable()
+{
+    sqlite_options opts;
+    opts.journal_mode = journal_mode::wal;
+    opts.synchronous = synchronous::full;
+    opts.busy_timeout = std::chrono::milliseconds(5000);
+    return opts;
+}
+
 class DBM_EXPORT sqlite_session : public session<sqlite_session>
 {
     friend class session;
@@ -19,10 +117,12 @@ public:
     ~sqlite_session();
 
     void connect(std::string_view db_file_name);
+    void connect(std::string_view db_file_name, sqlite_options const& opts);
 
 private:
     void close_impl();
     bool is_connected_impl() const { return db3_ != nullptr; }
+    bool ping_impl();
 
     void query_impl(std::string_view statement);
     void init_prepared_statement_impl(kind::prepared_statement& stmt);
@@ -40,12 +140,12 @@ private:
     void transaction_rollback_impl();
 
     kind::sql_rows select_rows_impl(std::string_view statement);
-    void free_table();
     void destroy_prepared_stmt_handles();
+    void apply_options(sqlite_options const& opts);
 
 //    std::string db_name_;       // database file name
     sqlite3* db3_{nullptr};      // database handle
-    char** azResult{nullptr};   // results of the query
+    std::function<bool(int)> busy_handler_;
 };
 
 }// namespace dbm
@@ -0,0 +1,483 @@
+#ifndef DBM_IDENTITY_CACHE_HPP
+#define DBM_IDENTITY_CACHE_HPP
+
+#include <dbm/dbm_common.hpp>
+#include <dbm/model_item.hpp>
+#include <dbm/model.hpp>
+#include <dbm/query_cache.hpp>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace dbm {
+
+/*!
+ * Primary key identity cache
+ *
+ * Records read by model::read_record() are cached by table and primary key values, so
+ * repeated reads of the same record do not hit the database. model::write_record() and
+ * model::delete_record() drop the record and other writes through the session (query(),
+ * DDL) invalidate the whole table. With write_through, write_record() stores the written
+ * values instead - only correct if the database stores them unchanged (no truncation,
+ * coercion, defaults, triggers or ON UPDATE columns).
+ *
+ * Entries are distributed over lock striped shards. Cached records are immutable shared
+ * snapshots, so concurrent readers only share a pointer. With the fifo eviction policy
+ * a hit takes only a shared shard lock.
+ *
+ * One cache is meant to be used for one database (table names are not qualified).
+ * Records changed by other processes are only bounded by ttl.
+ */
+class DBM_EXPORT identity_cache
+{
+public:
+    using clock_t = std::chrono::steady_clock;
+    using snapshot = std::shared_ptr<kind::sql_rows const>;
+
+    enum class eviction_policy
+    {
+        lru,  // least recently used (hit takes exclusive shard lock)
+        fifo, // oldest inserted
+    };
+
+    struct config
+    {
+        size_t capacity {100000};                      // max number of records (all shards)
+        size_t n_shards {16};
+        eviction_policy policy {eviction_policy::lru};
+        std::chrono::milliseconds ttl {0};             // 0 - records do not expire
+        bool write_through {false};                    // write_record() stores model values instead of dropping the record
+    };
+
+    struct statistics
+    {
+        uint64_t hits {0};
+        uint64_t misses {0};
+        uint64_t evictions {0};
+        uint64_t expirations {0};
+        uint64_t invalidations {0}; // records dropped by writes (table invalidations are not counted per record)
+        uint64_t rejected {0};      // results not stored because of a concurrent write
+        size_t entries {0};
+    };
+
+    // state captured before a record is read from (or written to) the database
+    struct ticket
+    {
+        uint64_t table_gen {0};
+        uint64_t shard_epoch {0};
+    };
+
+    identity_cache();
+
+    explicit identity_cache(config cfg);
+
+    identity_cache(identity_cache const&) = delete;
+
+    identity_cache& operator=(identity_cache const&) = delete;
+
+    /*!
+     * Cache key of a model record (table and primary key values)
+     *
+     * @return false if the model has no primary key or it is not defined
+     */
+    static bool make_key(model const& m, std::string& key);
+
+    /*!
+     * Snapshot of model readable items
+     *
+     * @return nullptr if any readable item is not defined or not writable
+     */
+    static snapshot make_snapshot(model const& m);
+
+    /*!
+     * Checks if snapshot contains all readable items of the model
+     */
+    static bool covers(snapshot const& snap, model const& m);
+
+    snapshot find(std::string const& key);
+
+    /*!
+     * Cached record of the key covering all readable items of the model (nullptr if not cached)
+     */
+    snapshot find(std::string const& key, model const& m);
+
+    /*!
+     * Cached record of the model primary key (nullptr if not cached)
+     */
+    snapshot find(model const& m);
+
+    ticket make_ticket(std::string const& key);
+
+    /*!
+     * Stores a record read from the database
+     *
+     * The record is not stored if the table or shard was written since the ticket was taken.
+     */
+    bool insert(std::string const& key, snapshot snap, ticket t);
+
+    /*!
+     * Stores a written record (nullptr only drops it)
+     *
+     * Concurrent writes of the shard since the ticket was taken drop the record.
+     */
+    void update(std::string const& key, snapshot snap, ticket t);
+
+    void erase(std::string const& key);
+
+    void invalidate(std::string_view table);
+
+    void invalidate(detail::statement_info const& info);
+
+    void invalidate_all();
+
+    config const& get_config() const noexcept { return cfg_; }
+
+    statistics stat() const;
+
+    void reset_stat();
+
+private:
+    struct entry
+    {
+        std::string key;
+        snapshot snap;
+        uint64_t table_gen;
+        clock_t::time_point expires;
+    };
+
+    struct shard
+    {
+        std::shared_mutex mtx;
+        std::list<entry> order;  // newest (or most recently used) first
+        std::unordered_map<std::string_view, std::list<entry>::iterator> entries; // keys point into order
+        uint64_t epoch {0};      // incremented by every record write
+    };
+
+    snapshot lookup(std::string const& key, model const* m);
+    shard& get_shard(std::string const& key);
+    uint64_t table_gen(std::string const& key) const;
+    bool store(shard& sh, std::string const& key, snapshot snap, ticket t, bool write);
+    void erase(shard& sh, std::list<entry>::iterator it);
+    static std::string_view table_of(std::string const& key);
+
+    config cfg_;                // immutable after construction
+    size_t shard_capacity_ {0};
+    std::unique_ptr<shard[]> shards_;
+
+    // table generations - incremented by table invalidation
+    std::shared_mutex mutable gen_mtx_;
+    std::unordered_map<std::string, uint64_t> table_gen_;
+    uint64_t all_gen_ {0};
+
+    std::atomic<uint64_t> hits_ {0};
+    std::atomic<uint64_t> misses_ {0};
+    std::atomic<uint64_t> evictions_ {0};
+    std::atomic<uint64_t> expirations_ {0};
+    std::atomic<uint64_t> invalidations_ {0};
+    std::atomic<uint64_t> rejected_ {0};
+    std::atomic<size_t> entries_ {0};
+};
+
+DBM_INLINE identity_cache::identity_cache()
+    : identity_cache(config {})
+{
+}
+
+DBM_INLINE identity_cache::identity_cache(config cfg)
+    : cfg_(cfg)
+{
+    if (cfg_.n_shards == 0)
+        throw_exception<std::domain_error>("Identity cache requires at least one shard");
+
+    shard_capacity_ = std::max<size_t>(1, (cfg_.capacity + cfg_.n_shards - 1) / cfg_.n_shards);
+    shards_ = std::make_unique<shard[]>(cfg_.n_shards);
+}
+
+DBM_INLINE bool identity_cache::make_key(model const& m, std::string& key)
+{
+    key = detail::normalize_table_name(m.table_name());
+    key.push_back('\0');
+
+    bool has_primary = false;
+    for (auto const& it : m.items()) {
+        if (!it.conf().primary())
+            continue;
+        if (!it.is_defined() || it.is_null())
+            return false;
+
+        key += it.to_string();
+        key.push_back('\0');
+        has_primary = true;
+    }
+    return has_primary;
+}
+
+DBM_INLINE identity_cache::snapshot identity_cache::make_snapshot(model const& m)
+{
+    kind::sql_fields names;
+    std::vector<std::string> values;
+    std::vector<bool> nulls;
+
+    for (auto const& it : m.items()) {
+        if (!it.conf().readable())
+            continue;
+
+        // database could assign a different value
+        if (!it.conf().writable() || !it.is_defined())
+            return nullptr;
+
+        names.push_back(it.key().get());
+        nulls.push_back(it.is_null());
+        values.push_back(it.is_null() ? std::string() : it.to_string());
+    }
+
+    kind::sql_rows rows;
+    rows.set_field_names(std::move(names));
+    auto& row = rows.emplace_back();
+    row.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (nulls[i])
+            row.emplace_back();
+        else
+            row.emplace_back(values[i].c_str(), values[i].size());
+    }
+
+    // copy values into an owned arena
+    return std::make_shared<kind::sql_rows const>(kind::sql_rows_dump(rows).restore());
+}
+
+DBM_INLINE bool identity_cache::covers(snapshot const& snap, model const& m)
+{
+    if (!snap || snap->empty())
+        return false;
+
+    for (auto const& it : m.items()) {
+        if (it.conf().readable() && snap->column_index(it.key_id()) < 0)
+            return false;
+    }
+    return true;
+}
+
+DBM_INLINE identity_cache::snapshot identity_cache::find(std::string const& key)
+{
+    return lookup(key, nullptr);
+}
+
+DBM_INLINE identity_cache::snapshot identity_cache::find(std::string const& key, model const& m)
+{
+    return lookup(key, &m);
+}
+
+DBM_INLINE identity_cache::snapshot identity_cache::find(model const& m)
+{
+    std::string key;
+    if (!make_key(m, key))
+        return nullptr;
+
+    return find(key, m);
+}
+
+DBM_INLINE identity_cache::ticket identity_cache::make_ticket(std::string const& key)
+{
+    auto& sh = get_shard(key);
+    ticket t;
+    t.table_gen = table_gen(key);
+    std::shared_lock lock(sh.mtx);
+    t.shard_epoch = sh.epoch;
+    return t;
+}
+
+DBM_INLINE bool identity_cache::insert(std::string const& key, snapshot snap, ticket t)
+{
+    if (!snap || snap->empty())
+        return false;
+    return store(get_shard(key), key, std::move(snap), t, false);
+}
+
+DBM_INLINE void identity_cache::update(std::string const& key, snapshot snap, ticket t)
+{
+    store(get_shard(key), key, std::move(snap), t, true);
+}
+
+DBM_INLINE void identity_cache::erase(std::string const& key)
+{
+    auto& sh = get_shard(key);
+    std::lock_guard lock(sh.mtx);
+    ++sh.epoch;
+
+    auto it = sh.entries.find(key);
+    if (it != sh.entries.end()) {
+        erase(sh, it->second);
+        ++invalidations_;
+    }
+}
+
+DBM_INLINE void identity_cache::invalidate(std::string_view table)
+{
+    // records of older generations are ignored and replaced lazily
+    std::lock_guard lock(gen_mtx_);
+    ++table_gen_[detail::normalize_table_name(table)];
+}
+
+DBM_INLINE void identity_cache::invalidate(detail::statement_info const& info)
+{
+    if (info.invalidate_all) {
+        invalidate_all();
+        return;
+    }
+    for (auto const& t : info.write_tables) {
+        invalidate(t);
+    }
+}
+
+DBM_INLINE void identity_cache::invalidate_all()
+{
+    {
+        std::lock_guard lock(gen_mtx_);
+        ++all_gen_;
+    }
+
+    for (size_t i = 0; i < cfg_.n_shards; ++i) {
+        auto& sh = shards_[i];
+        std::lock_guard lock(sh.mtx);
+        entries_ -= sh.entries.size();
+        sh.entries.clear();
+        sh.order.clear();
+    }
+}
+
+DBM_INLINE identity_cache::statistics identity_cache::stat() const
+{
+    statistics s;
+    s.hits = hits_;
+    s.misses = misses_;
+    s.evictions = evictions_;
+    s.expirations = expirations_;
+    s.invalidations = invalidations_;
+    s.rejected = rejected_;
+    s.entries = entries_;
+    return s;
+}
+
+DBM_INLINE void identity_cache::reset_stat()
+{
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+    expirations_ = 0;
+    invalidations_ = 0;
+    rejected_ = 0;
+}
+
+DBM_INLINE identity_cache::snapshot identity_cache::lookup(std::string const& key, model const* m)
+{
+    auto& sh = get_shard(key);
+    auto gen = table_gen(key);
+    bool expired = false;
+
+    auto lookup = [&](bool exclusive) -> snapshot {
+        auto it = sh.entries.find(key);
+        if (it == sh.entries.end() || it->second->table_gen != gen)
+            return nullptr;
+
+        expired = cfg_.ttl.count() > 0 && clock_t::now() >= it->second->expires;
+        if (expired) {
+            if (exclusive) {
+                erase(sh, it->second);
+                ++expirations_;
+            }
+            return nullptr;
+        }
+
+        if (exclusive && cfg_.policy == eviction_policy::lru) {
+            sh.order.splice(sh.order.begin(), sh.order, it->second);
+        }
+        return it->second->snap;
+    };
+
+    snapshot snap;
+    if (cfg_.policy == eviction_policy::lru) {
+        std::unique_lock lock(sh.mtx);
+        snap = lookup(true);
+    }
+    else {
+        {
+            std::shared_lock lock(sh.mtx);
+            snap = lookup(false);
+        }
+        // expired record is erased under the exclusive lock (it could be replaced meanwhile)
+        if (expired) {
+            std::unique_lock lock(sh.mtx);
+            snap = lookup(true);
+        }
+    }
+
+    // record missing some of the model columns is read from the database
+    if (m && !covers(snap, *m))
+        snap = nullptr;
+
+    ++(snap ? hits_ : misses_);
+    return snap;
+}
+
+DBM_INLINE identity_cache::shard& identity_cache::get_shard(std::string const& key)
+{
+    return shards_[std::hash<std::string>()(key) % cfg_.n_shards];
+}
+
+DBM_INLINE uint64_t identity_cache::table_gen(std::string const& key) const
+{
+    // generations only grow so the sum changes with any of them
+    std::shared_lock lock(gen_mtx_);
+    auto it = table_gen_.find(std::string(table_of(key)));
+    return all_gen_ + (it != table_gen_.end() ? it->second : 0);
+}
+
+DBM_INLINE bool identity_cache::store(shard& sh, std::string const& key, snapshot snap, ticket t, bool write)
+{
+    std::lock_guard lock(sh.mtx);
+
+    bool valid = t.shard_epoch == sh.epoch && t.table_gen == table_gen(key);
+    if (write)
+        ++sh.epoch;
+
+    auto it = sh.entries.find(key);
+    if (it != sh.entries.end() && (write || valid)) {
+        erase(sh, it->second);
+        if (write)
+            ++invalidations_;
+    }
+
+    if (!valid)
+        ++rejected_;
+    if (!valid || !snap)
+        return false;
+
+    sh.order.push_front({key, std::move(snap), t.table_gen, clock_t::now() + cfg_.ttl});
+    sh.entries.emplace(sh.order.front().key, sh.order.begin());
+    ++entries_;
+
+    while (sh.entries.size() > shard_capacity_) {
+        erase(sh, std::prev(sh.order.end()));
+        ++evictions_;
+    }
+    return true;
+}
+
+DBM_INLINE void identity_cache::erase(shard& sh, std::list<entry>::iterator it)
+{
+    sh.entries.erase(it->key);
+    sh.order.erase(it);
+    --entries_;
+}
+
+DBM_INLINE std::string_view identity_cache::table_of(std::string const& key)
+{
+    return std::string_view(key.c_str());
+}
+
+} // namespace dbm
+
+#endif //DBM_IDENTITY_CACHE_HPP
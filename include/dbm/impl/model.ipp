@@ -1,6 +1,8 @@
 #ifndef DBM_MODEL_IPP
 #define DBM_MODEL_IPP
 
+#include <dbm/identity_cache.hpp>
+
 namespace dbm {
 
 DBM_INLINE model::model(std::string table)
@@ -203,12 +205,43 @@ template<typename DBType>
 DBM_INLINE void model::write_record(DBType& s)
 {
     auto q = s.write_model_query(*this);
-    s.query(q);
+
+    std::string key;
+    auto const& cache = s.get_identity_cache();
+    if (!cache || !identity_cache::make_key(*this, key)) {
+        s.query(q);
+        return;
+    }
+
+    // ticket detects concurrent writes of the same record
+    auto t = cache->make_ticket(key);
+    utils::execute_at_exit drop_record([&] { cache->erase(key); });
+    s.query(q, false);
+    drop_record.cancel();
+
+    // stored values may differ from the model ones (unless write through is enabled),
+    // ignored insert may not change the record, transaction may be rolled back
+    bool store = cache->get_config().write_through && !ignore_insert_ && !s.in_transaction_;
+    cache->update(key, store ? identity_cache::make_snapshot(*this) : nullptr, t);
 }
 
 template<typename DBType>
 DBM_INLINE void model::read_record(DBType& s, const std::string& extra_condition)
 {
+    std::string key;
+    identity_cache::ticket t;
+    auto const& cache = s.get_identity_cache();
+    bool cached = cache && extra_condition.empty() && !s.in_transaction_ && identity_cache::make_key(*this, key);
+
+    if (cached) {
+        if (auto snap = cache->find(key, *this)) {
+            const auto& row = snap->front();
+            read_record(row);
+            return;
+        }
+        t = cache->make_ticket(key);
+    }
+
     auto q = s.self().read_model_query(*this, extra_condition);
     auto rows = s.select(q);
 
@@ -218,6 +251,10 @@ DBM_INLINE void model::read_record(DBType& s, const std::string& extra_condition
 
     const auto& row = rows.at(0);
     read_record(row);
+
+    if (cached) {
+        cache->insert(key, std::make_shared<kind::sql_rows const>(std::move(rows)), t);
+    }
 }
 
 DBM_INLINE void model::read_record(const kind::sql_row& row)
@@ -229,10 +266,10 @@ DBM_INLINE void model::read_record(const kind::sql_row& row)
     for (auto& it : items_) {
 
         if (it.conf().readable()) {
-            std::string const& k = it.key().get();
+            int idx = row.column_index(it.key_id());
 
-            if (row.field_map()->find(k) != row.field_map()->end()) {
-                const auto& v = row.at(k);
+            if (idx >= 0) {
+                const auto& v = row[static_cast<size_t>(idx)];
 
                 if (v.null()) {
                     it.set_value(nullptr);
@@ -249,7 +286,16 @@ template<typename DBType>
 DBM_INLINE void model::delete_record(DBType& s)
 {
     auto q = s.delete_model_query(*this);
-    s.query(q);
+
+    std::string key;
+    auto const& cache = s.get_identity_cache();
+    if (!cache || !identity_cache::make_key(*this, key)) {
+        s.query(q);
+        return;
+    }
+
+    utils::execute_at_exit drop_record([&] { cache->erase(key); });
+    s.query(q, false);
 }
 
 template<typename DBType>
@@ -10,6 +10,7 @@ DBM_INLINE model_item::model_item()
 
 DBM_INLINE model_item::model_item(const model_item& oth)
     : key_(oth.key_)
+    , key_id_(oth.key_id_)
     , tag_(oth.tag_)
     , conf_(oth.conf_)
     , dbtype_(oth.dbtype_)
@@ -22,6 +23,7 @@ DBM_INLINE model_item& model_item::operator=(const model_item& oth)
 {
     if (this != &oth) {
         key_ = oth.key_;
+        key_id_ = oth.key_id_;
         tag_ = oth.tag_;
         conf_ = oth.conf_;
         dbtype_ = oth.dbtype_;
@@ -89,6 +91,7 @@ DBM_INLINE const kind::custom_data_type& model_item::custom_data_type() const no
 DBM_INLINE void model_item::set(const kind::key& v)
 {
     key_ = v;
+    key_id_ = kind::column_id(v.get());
 }
 
 DBM_INLINE void model_item::set(const kind::tag& v)
@@ -45,6 +45,9 @@ DBM_INLINE void session<Impl>::transaction::perform(bool do_commit)
 template<typename Impl>
 DBM_INLINE session<Impl>::session(const session& oth)
     : last_statement_(oth.last_statement_)
+    , query_cache_(oth.query_cache_)
+    , identity_cache_(oth.identity_cache_)
+    , query_histogram_(oth.query_histogram_)
 {
 }
 
@@ -52,6 +55,13 @@ template<typename Impl>
 DBM_INLINE session<Impl>::session(session&& oth) noexcept
     : last_statement_(std::move(oth.last_statement_))
     , prepared_stm_handle_(std::move(oth.prepared_stm_handle_))
+    , prepared_stm_slots_(std::move(oth.prepared_stm_slots_))
+    , query_cache_(std::move(oth.query_cache_))
+    , identity_cache_(std::move(oth.identity_cache_))
+    , query_histogram_(std::move(oth.query_histogram_))
+    , in_transaction_(oth.in_transaction_)
+    , transaction_writes_all_(oth.transaction_writes_all_)
+    , transaction_writes_(std::move(oth.transaction_writes_))
 {
 }
 
@@ -60,6 +70,9 @@ DBM_INLINE session<Impl>& session<Impl>::operator=(const session& oth)
 {
     if (this != &oth) {
         last_statement_ = oth.last_statement_;
+        query_cache_ = oth.query_cache_;
+        identity_cache_ = oth.identity_cache_;
+        query_histogram_ = oth.query_histogram_;
     }
     return *this;
 }
@@ -70,6 +83,13 @@ DBM_INLINE session<Impl>& session<Impl>::operator=(session&& oth) noexcept
     if (this != &oth) {
         last_statement_ = std::move(oth.last_statement_);
         prepared_stm_handle_ = std::move(oth.prepared_stm_handle_);
+        prepared_stm_slots_ = std::move(oth.prepared_stm_slots_);
+        query_cache_ = std::move(oth.query_cache_);
+        identity_cache_ = std::move(oth.identity_cache_);
+        query_histogram_ = std::move(oth.query_histogram_);
+        in_transaction_ = oth.in_transaction_;
+        transaction_writes_all_ = oth.transaction_writes_all_;
+        transaction_writes_ = std::move(oth.transaction_writes_);
     }
     return *this;
 }
@@ -96,15 +116,169 @@ DBM_INLINE kind::sql_rows session<Impl>::select(const std::vector<std::string>&
         statement += criteria;
     }
 
-    return self().select_rows(statement);
+    return select(std::string_view(statement));
+}
+
+template<typename Impl>
+DBM_INLINE void session<Impl>::query(std::string_view statement)
+{
+    query(statement, true);
+}
+
+template<typename Impl>
+DBM_INLINE void session<Impl>::query(std::string_view statement, bool invalidate_identity)
+{
+    latency_histogram::scoped_timer timer(query_histogram_.get());
+
+    if (!query_cache_ && !identity_cache_) {
+        self().query_impl(statement);
+        return;
+    }
+
+    auto info = detail::parse_statement_info(statement);
+    bool succeeded = false;
+
+    // a failed statement may still have been partially applied
+    utils::execute_at_exit invalidate([&] { on_query_executed(info, succeeded, invalidate_identity); });
+    self().query_impl(statement);
+    succeeded = true;
+}
+
+template<typename Impl>
+DBM_INLINE void session<Impl>::query(kind::prepared_statement& stmt)
+{
+    latency_histogram::scoped_timer timer(query_histogram_.get());
+
+    // handle could be set by another session
+    if (stmt.slot() != kind::prepared_statement::no_slot)
+        init_prepared_statement(stmt);
+
+    if (!query_cache_ && !identity_cache_) {
+        self().query_impl(stmt);
+        return;
+    }
+
+    auto info = detail::parse_statement_info(stmt.statement());
+    bool succeeded = false;
+
+    utils::execute_at_exit invalidate([&] { on_query_executed(info, succeeded, true); });
+    self().query_impl(stmt);
+    succeeded = true;
+}
+
+template<typename Impl>
+DBM_INLINE kind::sql_rows session<Impl>::select(std::string_view statement)
+{
+    // cache hits are not recorded
+    auto fetch = [&] {
+        latency_histogram::scoped_timer timer(query_histogram_.get());
+        return select_rows(statement);
+    };
+
+    if (query_cache_ && !in_transaction_) {
+        return query_cache_->select(statement, fetch);
+    }
+    return fetch();
+}
+
+template<typename Impl>
+DBM_INLINE std::vector<std::vector<container_ptr>> session<Impl>::select(kind::prepared_statement& stmt)
+{
+    auto fetch = [&] {
+        latency_histogram::scoped_timer timer(query_histogram_.get());
+        // handle could be set by another session
+        if (stmt.slot() != kind::prepared_statement::no_slot)
+            init_prepared_statement(stmt);
+        return self().select_impl(stmt);
+    };
+
+    if (query_cache_ && !in_transaction_) {
+        return query_cache_->select(stmt, fetch);
+    }
+    return fetch();
+}
+
+template<typename Impl>
+DBM_INLINE void session<Impl>::on_query_executed(detail::statement_info const& info, bool succeeded, bool invalidate_identity)
+{
+    if (query_cache_)
+        query_cache_->invalidate(info);
+    if (identity_cache_ && invalidate_identity)
+        identity_cache_->invalidate(info);
+
+    if (in_transaction_) {
+        // other sessions may cache the old values until the transaction ends
+        if (info.invalidate_all)
+            transaction_writes_all_ = true;
+        transaction_writes_.insert(info.write_tables.begin(), info.write_tables.end());
+    }
+
+    if (!succeeded)
+        return;
+
+    if (info.begin_transaction) {
+        in_transaction_ = true;
+    }
+    else if (info.end_transaction && in_transaction_) {
+        if (transaction_writes_all_) {
+            if (query_cache_)
+                query_cache_->invalidate_all();
+            if (identity_cache_)
+                identity_cache_->invalidate_all();
+        }
+        else {
+            for (auto const& t : transaction_writes_) {
+                if (query_cache_)
+                    query_cache_->invalidate(t);
+                if (identity_cache_)
+                    identity_cache_->invalidate(t);
+            }
+        }
+        in_transaction_ = false;
+        transaction_writes_all_ = false;
+        transaction_writes_.clear();
+    }
+}
+
+template<typename Impl>
+DBM_INLINE void session<Impl>::init_prepared_statement(kind::prepared_statement& stmt)
+{
+    auto slot = stmt.slot();
+    if (slot == kind::prepared_statement::no_slot) {
+        self().init_prepared_statement_impl(stmt);
+        return;
+    }
+
+    // slots of every pool are numbered from 0, the slot may hold a statement of another pool
+    if (slot < prepared_stm_slots_.size() && prepared_stm_slots_[slot].second
+        && *prepared_stm_slots_[slot].first == stmt.statement()) {
+        kind::prepared_statement_manipulator(stmt).set_native_handle(prepared_stm_slots_[slot].second);
+        return;
+    }
+
+    // first use in this session (or slot taken by another statement)
+    kind::prepared_statement_manipulator(stmt).set_native_handle(nullptr);
+    self().init_prepared_statement_impl(stmt);
+
+    if (slot >= prepared_stm_slots_.size())
+        prepared_stm_slots_.resize(slot + 1, {nullptr, nullptr});
+    if (!prepared_stm_slots_[slot].second) {
+        auto p = prepared_stm_handle_.find(stmt.statement());
+        if (p != prepared_stm_handle_.end())
+            prepared_stm_slots_[slot] = {&p->first, p->second};
+    }
 }
 
 template<typename Impl>
 DBM_INLINE void session<Impl>::remove_prepared_statement(std::string const& s)
 {
     auto p = prepared_stm_handle_.find(s);
-    if (p != prepared_stm_handle_.end())
+    if (p != prepared_stm_handle_.end()) {
+        std::replace_if(prepared_stm_slots_.begin(), prepared_stm_slots_.end(),
+                        [hdl = p->second](auto const& v) { return v.second == hdl; },
+                        std::pair<std::string const*, void*> {nullptr, nullptr});
         prepared_stm_handle_.erase(p);
+    }
 }
 
 template<typename Impl>
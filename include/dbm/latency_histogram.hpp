@@ -0,0 +1,252 @@
+#ifndef DBM_LATENCY_HISTOGRAM_HPP
+#define DBM_LATENCY_HISTOGRAM_HPP
+
+#include <dbm/dbm_common.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dbm {
+
+/*!
+ * Lock-free latency histogram with logarithmic buckets
+ *
+ * Every power of two range of nanoseconds is split into 8 sub-buckets, so a bucket bound is
+ * within 12.5 % of the values it holds (values up to ~73 minutes, longer ones are counted in
+ * the last bucket). Recording is a few relaxed atomic operations and a snapshot may be taken
+ * at any time without locking.
+ */
+class DBM_EXPORT latency_histogram
+{
+public:
+    using duration = std::chrono::nanoseconds;
+
+    static constexpr unsigned sub_bucket_bits = 3;
+    static constexpr uint64_t n_sub_buckets = 1u << sub_bucket_bits;
+    static constexpr unsigned max_exponent = 42;
+    static constexpr size_t n_buckets = (max_exponent - sub_bucket_bits + 1) * n_sub_buckets;
+
+    struct snapshot
+    {
+        uint64_t count {0};
+        duration sum {0};
+        duration max {0};
+        std::vector<std::pair<duration, uint64_t>> buckets;   // (bucket upper bound, count) of non-empty buckets in ascending order
+
+        duration mean() const
+        {
+            return count ? duration(sum.count() / static_cast<int64_t>(count)) : duration(0);
+        }
+
+        /*!
+         * Returns value at quantile q (0 - 1) with bucket precision
+         */
+        duration percentile(double q) const
+        {
+            if (!count)
+                return duration(0);
+
+            auto target = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count)));
+            target = std::max<uint64_t>(1, std::min(target, count));
+
+            uint64_t n = 0;
+            for (auto const& [upper, cnt] : buckets) {
+                n += cnt;
+                if (n >= target)
+                    return std::min(upper, max);
+            }
+            return max;
+        }
+
+        /*!
+         * Returns values recorded after an earlier snapshot prev of the same histogram
+         *
+         * Max is the upper bound of the highest bucket recorded since. If the histogram was reset
+         * in between, the snapshot is returned unchanged.
+         */
+        snapshot since(snapshot const& prev) const
+        {
+            if (prev.count > count)
+                return *this;
+
+            snapshot s;
+            s.count = count - prev.count;
+            s.sum = sum - prev.sum;
+
+            auto it = prev.buckets.begin();
+            for (auto const& [upper, cnt] : buckets) {
+                for (; it != prev.buckets.end() && it->first < upper; ++it) {
+                }
+                auto n = (it != prev.buckets.end() && it->first == upper) ? cnt - std::min(cnt, it->second) : cnt;
+                if (n) {
+                    s.buckets.emplace_back(upper, n);
+                    s.max = std::min(upper, max);
+                }
+            }
+            return s;
+        }
+
+        /*!
+         * Writes histogram in Prometheus text format (values in seconds)
+         *
+         * Fixed 'le' bounds are used. A bucket is counted in the first bound which is not lower
+         * than its upper bound. The type line is written only once per metric, so it is omitted
+         * (type_line false) when more histograms with different labels are written under one name.
+         */
+        void write_prometheus(std::ostream& os, std::string const& name, std::string const& labels = "", bool type_line = true) const
+        {
+            static constexpr double bounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                                0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+
+            auto prefix = labels.empty() ? std::string() : labels + ",";
+            auto label_set = labels.empty() ? std::string() : "{" + labels + "}";
+
+            if (type_line)
+                os << "# TYPE " << name << " histogram\n";
+
+            auto it = buckets.begin();
+            uint64_t n = 0;
+            for (double le : bounds) {
+                auto le_ns = static_cast<int64_t>(le * 1e9);
+                for (; it != buckets.end() && it->first.count() <= le_ns; ++it) {
+                    n += it->second;
+                }
+                os << name << "_bucket{" << prefix << "le=\"" << le << "\"} " << n << "\n";
+            }
+            os << name << "_bucket{" << prefix << "le=\"+Inf\"} " << count << "\n";
+            auto precision = os.precision(9);
+            os << name << "_sum" << label_set << " " << std::chrono::duration<double>(sum).count() << "\n";
+            os.precision(precision);
+            os << name << "_count" << label_set << " " << count << "\n";
+        }
+    };
+
+    /*!
+     * Records time elapsed until destruction (does nothing if histogram is nullptr)
+     */
+    class scoped_timer
+    {
+    public:
+        explicit scoped_timer(latency_histogram* h)
+            : h_(h)
+        {
+            if (h_)
+                tp_ = std::chrono::steady_clock::now();
+        }
+
+        scoped_timer(scoped_timer const&) = delete;
+
+        scoped_timer& operator=(scoped_timer const&) = delete;
+
+        ~scoped_timer()
+        {
+            if (h_)
+                h_->record(std::chrono::steady_clock::now() - tp_);
+        }
+
+    private:
+        latency_histogram* h_;
+        std::chrono::steady_clock::time_point tp_;
+    };
+
+    latency_histogram() = default;
+
+    latency_histogram(latency_histogram const&) = delete;
+
+    latency_histogram& operator=(latency_histogram const&) = delete;
+
+    void record(duration d)
+    {
+        auto v = d.count() > 0 ? static_cast<uint64_t>(d.count()) : 0;
+
+        buckets_[bucket_index(v)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+
+        uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (prev < v && !max_.compare_exchange_weak(prev, v, std::memory_order_relaxed)) {
+        }
+    }
+
+    snapshot snap() const
+    {
+        snapshot s;
+
+        for (size_t i = 0; i < n_buckets; ++i) {
+            if (auto n = buckets_[i].load(std::memory_order_relaxed)) {
+                s.count += n;
+                s.buckets.emplace_back(duration(static_cast<int64_t>(bucket_upper_bound(i))), n);
+            }
+        }
+
+        s.sum = duration(static_cast<int64_t>(sum_.load(std::memory_order_relaxed)));
+        s.max = duration(static_cast<int64_t>(max_.load(std::memory_order_relaxed)));
+        return s;
+    }
+
+    void reset()
+    {
+        for (auto& n : buckets_) {
+            n.store(0, std::memory_order_relaxed);
+        }
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    static size_t bucket_index(uint64_t v)
+    {
+        if (v < n_sub_buckets)
+            return static_cast<size_t>(v);
+
+        unsigned e = log2(v);
+        if (e >= max_exponent)
+            return n_buckets - 1;
+
+        return (e - sub_bucket_bits + 1) * n_sub_buckets + ((v >> (e - sub_bucket_bits)) & (n_sub_buckets - 1));
+    }
+
+    static uint64_t bucket_lower_bound(size_t i)
+    {
+        if (i < n_sub_buckets)
+            return i;
+
+        unsigned e = static_cast<unsigned>(i / n_sub_buckets) + sub_bucket_bits - 1;
+        return (n_sub_buckets + i % n_sub_buckets) << (e - sub_bucket_bits);
+    }
+
+    static uint64_t bucket_upper_bound(size_t i)
+    {
+        if (i < n_sub_buckets)
+            return i + 1;
+
+        unsigned e = static_cast<unsigned>(i / n_sub_buckets) + sub_bucket_bits - 1;
+        return bucket_lower_bound(i) + (uint64_t(1) << (e - sub_bucket_bits));
+    }
+
+private:
+    static unsigned log2(uint64_t v)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<unsigned>(__builtin_clzll(v));
+#else
+        unsigned e = 0;
+        while (v >>= 1) {
+            ++e;
+        }
+        return e;
+#endif
+    }
+
+    std::array<std::atomic<uint64_t>, n_buckets> buckets_ {};
+    std::atomic<uint64_t> sum_ {0};
+    std::atomic<uint64_t> max_ {0};
+};
+
+} // namespace dbm
+
+#endif //DBM_LATENCY_HISTOGRAM_HPP
@@ -2,6 +2,7 @@
 #define DBM_MODEL_ITEM_HPP
 
 #include <dbm/container.hpp>
+#include <dbm/column_id.hpp>
 #include <bitset>
 
 namespace dbm {
@@ -51,6 +52,11 @@ public:
 
     constexpr const kind::tag& tag() const noexcept;
 
+    /*!
+     * Interned key (matches sql rows field names without string hashing)
+     */
+    kind::column_id key_id() const noexcept { return key_id_; }
+
     container& get_container() __attribute_deprecated__;
 
     const container& get_container() const __attribute_deprecated__;
@@ -136,6 +142,7 @@ private:
         (1u << conf_flags::w_quotes);
 
     kind::key key_{""};
+    kind::column_id key_id_;
     kind::tag tag_{""};
     std::bitset<conf_flags_num_items> conf_ {conf_default};
     kind::custom_data_type dbtype_ {""};
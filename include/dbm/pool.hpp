@@ -3,11 +3,25 @@
 
 #include "pool_intern_item.hpp"
 #include "pool_connection.hpp"
+#include "coro.hpp"
+#include "latency_histogram.hpp"
+#include "detail/idle_stack.hpp"
+#include "detail/bounded_queue.hpp"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <future>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <queue>
+#include <set>
+#include <tuple>
+#include <type_traits>
 #include <numeric>
+#include <optional>
 #include <shared_mutex>
+#include <sstream>
 #include <atomic>
 
 namespace dbm {
@@ -17,8 +31,16 @@ enum class pool_event
     acquired,
     handover,
     timeout,
+    rejected,
     heartbeat_success,
     heartbeat_fail,
+    limit_increased,
+    limit_decreased,
+    queue_full,
+    circuit_opened,
+    circuit_half_opened,
+    circuit_closed,
+    circuit_rejected,
 };
 
 DBM_INLINE std::string to_string(pool_event event)
@@ -27,12 +49,78 @@ DBM_INLINE std::string to_string(pool_event event)
         case pool_event::acquired:          return "acquired";
         case pool_event::handover:          return "handover";
         case pool_event::timeout:           return "timeout";
+        case pool_event::rejected:          return "rejected";
         case pool_event::heartbeat_success: return "heartbeat_success";
         case pool_event::heartbeat_fail:    return "heartbeat_fail";
+        case pool_event::limit_increased:   return "limit_increased";
+        case pool_event::limit_decreased:   return "limit_decreased";
+        case pool_event::queue_full:        return "queue_full";
+        case pool_event::circuit_opened:    return "circuit_opened";
+        case pool_event::circuit_half_opened: return "circuit_half_opened";
+        case pool_event::circuit_closed:    return "circuit_closed";
+        case pool_event::circuit_rejected:  return "circuit_rejected";
         default:                            return "unknown";
     }
 }
 
+/*!
+ * Acquire priority class (waiting requests of a higher class are served first)
+ */
+enum class pool_priority
+{
+    high,
+    normal,
+    low,
+};
+
+DBM_INLINE std::string to_string(pool_priority priority)
+{
+    switch (priority) {
+        case pool_priority::high:   return "high";
+        case pool_priority::normal: return "normal";
+        case pool_priority::low:    return "low";
+        default:                    return "unknown";
+    }
+}
+
+/*!
+ * Pool circuit breaker state
+ */
+enum class pool_circuit_state
+{
+    closed,     // normal operation
+    open,       // acquire fails fast
+    half_open,  // database is being probed
+};
+
+DBM_INLINE std::string to_string(pool_circuit_state state)
+{
+    switch (state) {
+        case pool_circuit_state::closed:    return "closed";
+        case pool_circuit_state::open:      return "open";
+        case pool_circuit_state::half_open: return "half_open";
+        default:                            return "unknown";
+    }
+}
+
+/*!
+ * Thrown by pool acquire while the circuit breaker is open
+ */
+class DBM_EXPORT pool_circuit_open_error : public std::domain_error
+{
+public:
+    using std::domain_error::domain_error;
+};
+
+/*!
+ * Thrown by pool acquire when the wait queue is full
+ */
+class DBM_EXPORT pool_queue_full_error : public std::domain_error
+{
+public:
+    using std::domain_error::domain_error;
+};
+
 template<typename DBSession, typename SessionInitializer>
 class DBM_EXPORT pool
 {
@@ -45,6 +133,9 @@ public:
     using db_session_initializer_type = SessionInitializer;
     using pool_intern_item_type = pool_intern_item<db_session_type>;
     using pool_connection_type = pool_connection<pool>;
+    using time_point = typename pool_intern_item_type::clock_t::time_point;
+
+    static constexpr size_t n_priorities = 3;
 
     struct statistics
     {
@@ -56,11 +147,63 @@ public:
         size_t n_acquiring_max {0};
         size_t n_max_conn {0};
         size_t n_timeouts {0};
+        size_t n_rejected {0};                          // acquires rejected as their deadline could not be met
         size_t n_heartbeats {0};
-        std::map<long, size_t> acquire_stat;
+        size_t n_events_dispatched {0};
+        size_t n_events_dropped {0};
+        size_t n_closed_idle {0};                       // connections closed by idle timeout
+        size_t n_closed_lifetime {0};                   // connections closed by max lifetime
+        size_t n_validations {0};                       // sessions validated on acquire
+        size_t n_validations_failed {0};
+        size_t n_conn_limit {0};                        // effective connection limit
+        size_t n_limit_increased {0};                   // adaptive limit increases
+        size_t n_limit_decreased {0};                   // adaptive limit decreases
+        size_t n_queue_full {0};                        // acquires failed as the wait queue was full
+        size_t n_circuit_opened {0};
+        size_t n_circuit_rejected {0};                  // acquires failed by open circuit
+        pool_circuit_state circuit {pool_circuit_state::closed};
+        size_t n_jobs_queued {0};                       // submitted jobs waiting for a worker
+        size_t n_jobs_done {0};
+        size_t n_jobs_rejected {0};                     // jobs rejected as the job queue was full
+        size_t n_affinity_hits {0};                     // acquires which got the session preferred by affinity
+        size_t n_affinity_misses {0};
+
+        double affinity_hit_rate() const
+        {
+            auto n = n_affinity_hits + n_affinity_misses;
+            return n ? static_cast<double>(n_affinity_hits) / static_cast<double>(n) : 0;
+        }
+        std::map<long, size_t> acquire_stat;            // acquire wait count per 100 ms range (derived from acquire_wait)
+        latency_histogram::snapshot acquire_wait;       // time spent in acquire
+        std::array<latency_histogram::snapshot, n_priorities> acquire_wait_priority; // time spent in acquire per priority class
+        latency_histogram::snapshot hold_time;          // time between acquire and release
+        latency_histogram::snapshot query_time;         // database round trip time of pool sessions
+    };
+
+    /*!
+     * Adaptive connection limit settings
+     *
+     * The effective limit is adjusted within [min_conn, max connections] once per interval (AIMD).
+     * It is decreased multiplicatively when the median query time of the interval rises above
+     * the baseline (the lowest median observed, slowly following the current one) by more than
+     * latency_tolerance, as the database is considered saturated. Otherwise it is increased by one
+     * when all connections are in use and requests are waiting or the 90th percentile of acquire
+     * wait exceeds target_wait.
+     */
+    struct adaptive_limit_options
+    {
+        bool enabled {false};
+        size_t min_conn {1};
+        std::chrono::milliseconds interval {1000};
+        std::chrono::milliseconds target_wait {10};
+        double latency_tolerance {2.0};
+        double backoff {0.75};                          // limit multiplier on saturation
     };
 
     static constexpr id_t invalid_id = -1;
+    static constexpr size_t event_queue_size = 1024;
+    static constexpr size_t job_queue_size = 1024;
+    static constexpr size_t affinity_table_bits = 8;
 
 
     explicit pool(SessionInitializer&& session_init = SessionInitializer())
@@ -86,10 +229,67 @@ public:
         return max_conn_;
     }
 
-    void set_max_connections(size_t n)
+    void set_max_connections(size_t n);
+
+    /*!
+     * Returns effective connection limit (max connections unless adaptive limit is enabled)
+     */
+    size_t connection_limit() const
+    {
+        return conn_limit_;
+    }
+
+    auto adaptive_limit() const
+    {
+        std::shared_lock lock(mtx_);
+        return adaptive_;
+    }
+
+    /*!
+     * Sets adaptive connection limit controlled by the background thread
+     *
+     * The limit starts at the current number of connections. Sessions above the limit are closed
+     * when idle or released. Decisions are sent as limit_increased/limit_decreased events.
+     */
+    void set_adaptive_limit(adaptive_limit_options const& options);
+
+    auto max_acquiring() const
+    {
+        std::shared_lock lock(mtx_);
+        return max_acquiring_;
+    }
+
+    /*!
+     * Sets max number of waiting acquire requests (0 - unlimited)
+     *
+     * Requests which would exceed it fail immediately with pool_queue_full_error.
+     */
+    void set_max_acquiring(size_t n)
     {
         std::lock_guard lock(mtx_);
-        max_conn_ = n;
+        max_acquiring_ = n;
+    }
+
+    /*!
+     * Sets circuit breaker (failure_threshold 0 - disabled)
+     *
+     * The circuit opens after failure_threshold consecutive connect or session check failures.
+     * While it is open, acquire and waiting requests fail fast with pool_circuit_open_error.
+     * After open_time the background thread probes the database with one idle session or a new
+     * connection (half open) and closes the circuit on success or opens it again on failure.
+     */
+    void set_circuit_breaker(size_t failure_threshold, std::chrono::milliseconds open_time = std::chrono::milliseconds(5000))
+    {
+        circuit_open_time_ = open_time;
+        circuit_threshold_ = failure_threshold;
+        if (!failure_threshold) {
+            circuit_ = pool_circuit_state::closed;
+        }
+    }
+
+    pool_circuit_state circuit_state() const
+    {
+        return circuit_;
     }
 
     auto acquire_timeout() const
@@ -104,25 +304,182 @@ public:
         acquire_timeout_ = to;
     }
 
+    /*!
+     * Sets pool event callback
+     *
+     * Async events are put to a bounded queue (event_queue_size) and delivered by a single
+     * dispatcher thread, started with the first async callback. Events are dropped and
+     * counted in statistics::n_events_dropped when the queue is full.
+     * Sync events are delivered from the thread which caused the event.
+     */
     void set_event_callback(EventCallback&& cb, bool async = true)
     {
-        std::lock_guard lock(mtx_);
+        std::lock_guard lock(mtx_event_);
         event_cb_ = std::move(cb);
         event_cb_async_ = async;
+        has_event_cb_ = static_cast<bool>(event_cb_);
+
+        if (has_event_cb_ && async && !event_thr_.joinable()) {
+            event_thr_ = std::thread([this] { event_dispatch_task(); });
+        }
+    }
+
+    auto min_idle() const
+    {
+        return min_idle_.load();
+    }
+
+    /*!
+     * Sets number of idle connections kept open by the background thread
+     *
+     * Missing connections are created in parallel (limited by max connections).
+     * Idle timeout does not close connections below this number.
+     */
+    void set_min_idle(size_t n)
+    {
+        min_idle_ = n;
+    }
+
+    auto idle_timeout() const
+    {
+        return idle_timeout_.load();
+    }
+
+    /*!
+     * Sets time after which an idle connection is closed (0 - never)
+     */
+    void set_idle_timeout(std::chrono::milliseconds ms)
+    {
+        idle_timeout_ = ms;
     }
 
+    auto max_lifetime() const
+    {
+        return max_lifetime_.load();
+    }
+
+    /*!
+     * Sets time after which a connection is closed (0 - never)
+     *
+     * Idle connections are closed by the background thread, active ones when released.
+     */
+    void set_max_lifetime(std::chrono::milliseconds ms)
+    {
+        max_lifetime_ = ms;
+    }
+
+    /*!
+     * Creates connections in parallel until there are at least min_idle idle connections
+     *
+     * Returns number of connections created.
+     */
+    size_t warm_up();
+
     void set_heartbeat_interval(std::chrono::milliseconds ms)
     {
-        std::lock_guard lock(mtx_);
         heartbeat_interval_ = ms;
     }
 
+    /*!
+     * Sets query used by heartbeats instead of session ping (empty - ping)
+     *
+     * The query is expected to return at least one row.
+     */
     void set_heartbeat_query(std::string query)
     {
         std::lock_guard lock(mtx_);
         heartbeat_query_ = std::move(query);
     }
 
+    /*!
+     * Sets number of threads performing heartbeats in parallel
+     */
+    void set_heartbeat_parallelism(size_t n)
+    {
+        std::lock_guard lock(mtx_);
+        heartbeat_parallelism_ = std::max<size_t>(n, 1);
+    }
+
+    auto validation_interval() const
+    {
+        return validation_interval_.load();
+    }
+
+    /*!
+     * Sets time since last use after which an idle session is pinged before it is acquired (0 - never)
+     *
+     * A session which fails validation is closed and the next one is taken. Sessions handed over
+     * to waiting acquirers were just released and are not validated.
+     */
+    void set_validation_interval(std::chrono::milliseconds ms)
+    {
+        validation_interval_ = ms;
+    }
+
+    /*!
+     * Sets result cache shared by all pool sessions (nullptr disables caching)
+     *
+     * The cache is assigned to sessions when they are acquired.
+     */
+    void set_query_cache(std::shared_ptr<query_cache> cache)
+    {
+        std::lock_guard lock(mtx_caches_);
+        query_cache_ = std::move(cache);
+    }
+
+    std::shared_ptr<query_cache> get_query_cache() const
+    {
+        std::lock_guard lock(mtx_caches_);
+        return query_cache_;
+    }
+
+    /*!
+     * Sets primary key identity cache shared by all pool sessions (nullptr disables caching)
+     */
+    void set_identity_cache(std::shared_ptr<identity_cache> cache)
+    {
+        std::lock_guard lock(mtx_caches_);
+        identity_cache_ = std::move(cache);
+    }
+
+    std::shared_ptr<identity_cache> get_identity_cache() const
+    {
+        std::lock_guard lock(mtx_caches_);
+        return identity_cache_;
+    }
+
+    /*!
+     * Registers a statement prepared by every pool session and returns its id
+     *
+     * Registered statements are prepared when a connection is created, idle sessions prepare them
+     * in the background thread (others on first use). Statements made by make_statement resolve the
+     * session handle by id, without a lookup by statement. Ids are unique within the pool only, a session
+     * checks the statement of a slot before reusing its handle.
+     */
+    size_t register_statement(std::string statement)
+    {
+        std::lock_guard lock(mtx_statements_);
+        statements_.push_back(std::move(statement));
+        statements_pending_ = true;
+        return statements_.size() - 1;
+    }
+
+    /*!
+     * Returns prepared statement of registered statement id with parameters
+     */
+    template<typename... Args>
+    kind::prepared_statement make_statement(size_t id, Args&&... args) const
+    {
+        std::shared_lock lock(mtx_statements_);
+        if (id >= statements_.size()) {
+            throw_exception<std::out_of_range>("No such registered statement");
+        }
+
+        kind::prepared_statement stmt(statements_[id], std::forward<Args>(args)...);
+        kind::prepared_statement_manipulator(stmt).set_slot(id);
+        return stmt;
+    }
+
     void reset_heartbeats_counter()
     {
         std::lock_guard lock(mtx_);
@@ -131,41 +488,233 @@ public:
 
     void reset_stat()
     {
-        std::lock_guard lock(mtx_);
-        stat_ = {};
+        stat_n_acquired_ = 0;
+        stat_n_acquiring_max_ = 0;
+        stat_n_max_conn_ = 0;
+        stat_n_timeouts_ = 0;
+        stat_n_rejected_ = 0;
+        stat_n_events_dispatched_ = 0;
+        stat_n_events_dropped_ = 0;
+        stat_n_closed_idle_ = 0;
+        stat_n_closed_lifetime_ = 0;
+        stat_n_validations_ = 0;
+        stat_n_validations_failed_ = 0;
+        stat_n_limit_increased_ = 0;
+        stat_n_limit_decreased_ = 0;
+        stat_n_queue_full_ = 0;
+        stat_n_circuit_opened_ = 0;
+        stat_n_circuit_rejected_ = 0;
+        stat_n_jobs_done_ = 0;
+        stat_n_jobs_rejected_ = 0;
+        stat_n_affinity_hits_ = 0;
+        stat_n_affinity_misses_ = 0;
+        acquire_wait_.reset();
+        for (auto& it : acquire_wait_priority_) {
+            it.reset();
+        }
+        hold_time_.reset();
+        query_time_->reset();
     }
 
     auto stat() const
     {
         statistics s;
-        std::shared_lock lock(mtx_); // TODO: locking mutex is not the best way to get stat data
-        s = stat_;
-        s.n_conn = sessions_idle_.size() + sessions_active_.size();
-        s.n_active_conn = sessions_active_.size();
-        s.n_idle_conn = sessions_idle_.size();
-        s.n_acquiring = acquiring_.size();
+        s.n_conn = num_connections();
+        s.n_idle_conn = num_idle_connections();
+        s.n_active_conn = num_active_connections();
+        s.n_acquired = stat_n_acquired_;
+        s.n_acquiring = n_waiting_;
+        s.n_acquiring_max = stat_n_acquiring_max_;
+        s.n_max_conn = stat_n_max_conn_;
+        s.n_timeouts = stat_n_timeouts_;
+        s.n_rejected = stat_n_rejected_;
         s.n_heartbeats = heartbeat_counter_;
+        s.n_events_dispatched = stat_n_events_dispatched_;
+        s.n_events_dropped = stat_n_events_dropped_;
+        s.n_closed_idle = stat_n_closed_idle_;
+        s.n_closed_lifetime = stat_n_closed_lifetime_;
+        s.n_validations = stat_n_validations_;
+        s.n_validations_failed = stat_n_validations_failed_;
+        s.n_conn_limit = conn_limit_;
+        s.n_limit_increased = stat_n_limit_increased_;
+        s.n_limit_decreased = stat_n_limit_decreased_;
+        s.n_queue_full = stat_n_queue_full_;
+        s.n_circuit_opened = stat_n_circuit_opened_;
+        s.n_circuit_rejected = stat_n_circuit_rejected_;
+        s.circuit = circuit_;
+        s.n_jobs_queued = jobs_.size();
+        s.n_jobs_done = stat_n_jobs_done_;
+        s.n_jobs_rejected = stat_n_jobs_rejected_;
+        s.n_affinity_hits = stat_n_affinity_hits_;
+        s.n_affinity_misses = stat_n_affinity_misses_;
+
+        s.acquire_wait = acquire_wait_.snap();
+        for (size_t i = 0; i < n_priorities; ++i) {
+            s.acquire_wait_priority[i] = acquire_wait_priority_[i].snap();
+        }
+        s.hold_time = hold_time_.snap();
+        s.query_time = query_time_->snap();
+
+        long step = stat_wait_step_.count();
+        for (auto const& [upper, n] : s.acquire_wait.buckets) {
+            // bucket is assigned to a range by the highest value it holds
+            auto ms = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(upper - std::chrono::nanoseconds(1)).count());
+            s.acquire_stat[ms ? (ms + step - 1) / step * step : 1] += n;
+        }
+
         return s;
     }
 
-    pool_connection_type acquire();
+    /*!
+     * Returns pool statistics in Prometheus text exposition format
+     *
+     * Metric names start with prefix, labels (e.g. pool="main") are added to every sample.
+     */
+    std::string to_prometheus(std::string const& prefix = "dbm_pool", std::string const& labels = "") const
+    {
+        auto s = stat();
+        auto label_set = labels.empty() ? std::string() : "{" + labels + "}";
+        std::ostringstream os;
+
+        auto write = [&](char const* name, char const* type, size_t value) {
+            os << "# TYPE " << prefix << "_" << name << " " << type << "\n";
+            os << prefix << "_" << name << label_set << " " << value << "\n";
+        };
+
+        write("connections", "gauge", s.n_conn);
+        write("connections_active", "gauge", s.n_active_conn);
+        write("connections_idle", "gauge", s.n_idle_conn);
+        write("acquiring", "gauge", s.n_acquiring);
+        write("acquired_total", "counter", s.n_acquired);
+        write("timeouts_total", "counter", s.n_timeouts);
+        write("rejected_total", "counter", s.n_rejected);
+        write("heartbeats_total", "counter", s.n_heartbeats);
+        write("events_dispatched_total", "counter", s.n_events_dispatched);
+        write("events_dropped_total", "counter", s.n_events_dropped);
+        write("closed_idle_total", "counter", s.n_closed_idle);
+        write("closed_lifetime_total", "counter", s.n_closed_lifetime);
+        write("validations_total", "counter", s.n_validations);
+        write("validations_failed_total", "counter", s.n_validations_failed);
+        write("connection_limit", "gauge", s.n_conn_limit);
+        write("limit_increased_total", "counter", s.n_limit_increased);
+        write("limit_decreased_total", "counter", s.n_limit_decreased);
+        write("queue_full_total", "counter", s.n_queue_full);
+        write("circuit_state", "gauge", static_cast<size_t>(s.circuit));
+        write("circuit_opened_total", "counter", s.n_circuit_opened);
+        write("circuit_rejected_total", "counter", s.n_circuit_rejected);
+        write("jobs_queued", "gauge", s.n_jobs_queued);
+        write("jobs_done_total", "counter", s.n_jobs_done);
+        write("jobs_rejected_total", "counter", s.n_jobs_rejected);
+        write("affinity_hits_total", "counter", s.n_affinity_hits);
+        write("affinity_misses_total", "counter", s.n_affinity_misses);
+        s.acquire_wait.write_prometheus(os, prefix + "_acquire_wait_seconds", labels);
+        for (size_t i = 0; i < n_priorities; ++i) {
+            auto priority_label = "priority=\"" + to_string(static_cast<pool_priority>(i)) + "\"";
+            s.acquire_wait_priority[i].write_prometheus(os, prefix + "_acquire_wait_priority_seconds",
+                                                        labels.empty() ? priority_label : labels + "," + priority_label,
+                                                        i == 0);
+        }
+        s.hold_time.write_prometheus(os, prefix + "_hold_seconds", labels);
+        s.query_time.write_prometheus(os, prefix + "_query_seconds", labels);
+
+        return os.str();
+    }
 
-    auto num_connections() const
+    pool_connection_type acquire()
     {
-        std::shared_lock lock(mtx_);
-        return sessions_active_.size() + sessions_idle_.size();
+        return acquire(pool_priority::normal);
     }
 
-    auto num_active_connections() const
+    /*!
+     * Runs fn(DBSession&) on a pooled connection and returns its result as a future
+     *
+     * Jobs are put to a bounded queue (job_queue_size) served by worker threads, one per connection of the
+     * current connection limit (see set_max_connections() and set_adaptive_limit()), started with the first
+     * job. Workers above a lowered limit are parked. A worker acquires a connection and keeps it while there
+     * are queued jobs.
+     * Throws pool_queue_full_error if the queue is full. Exceptions thrown by fn or by acquire are
+     * stored in the future.
+     */
+    template<typename Fn>
+    std::future<std::invoke_result_t<Fn&, DBSession&>> submit(Fn&& fn);
+
+    /*!
+     * Acquires a connection with priority and deadline
+     *
+     * Waiting requests are served by priority class, then by the earlier deadline. The request
+     * fails at the deadline or after acquire timeout, whichever comes first. A request with
+     * a deadline is rejected immediately if it is not expected to be served in time, based on
+     * its position in the queue and the average connection hold time.
+     */
+    pool_connection_type acquire(pool_priority priority, time_point deadline = time_point::max())
     {
-        std::shared_lock lock(mtx_);
-        return sessions_active_.size();
+        return acquire_impl(priority, deadline, affinity_ ? std::optional(thread_affinity_key()) : std::nullopt);
+    }
+
+    /*!
+     * Acquires a connection preferring the idle session last acquired with the same affinity key
+     */
+    pool_connection_type acquire(size_t affinity_key, pool_priority priority = pool_priority::normal, time_point deadline = time_point::max())
+    {
+        return acquire_impl(priority, deadline, affinity_key);
+    }
+
+    bool affinity() const
+    {
+        return affinity_;
+    }
+
+    /*!
+     * Enables soft connection affinity for acquire without a key
+     *
+     * The session last acquired by the calling thread is preferred when it is idle (and nobody is
+     * waiting), so its prepared statements and server side state stay warm. Sessions are remembered
+     * in a small table indexed by key hash, so colliding keys only lose their preference.
+     */
+    void set_affinity(bool enable)
+    {
+        affinity_ = enable;
+    }
+
+#ifdef DBM_COROUTINES
+    class acquire_awaiter;
+
+    acquire_awaiter co_acquire(pool_priority priority = pool_priority::normal, time_point deadline = time_point::max());
+
+    /*!
+     * Sets executor used to resume coroutine waiters and to run coroutine queries
+     *
+     * Without executor the operations are not asynchronous: waiters are resumed on the thread
+     * releasing the connection (or destroying the pool) and coroutine queries block the awaiting thread.
+     */
+    void set_coro_executor(coro_executor executor)
+    {
+        std::lock_guard lock(mtx_);
+        coro_executor_ = std::move(executor);
     }
 
-    auto num_idle_connections() const
+    coro_executor get_coro_executor() const
     {
         std::shared_lock lock(mtx_);
-        return sessions_idle_.size();
+        return coro_executor_;
+    }
+#endif
+
+    size_t num_connections() const
+    {
+        return n_conn_;
+    }
+
+    size_t num_active_connections() const
+    {
+        size_t n_conn = n_conn_;
+        size_t n_idle = idle_.size();
+        return n_conn > n_idle ? n_conn - n_idle : 0;
+    }
+
+    size_t num_idle_connections() const
+    {
+        return idle_.size();
     }
 
     auto heartbeats_count()->size_t const
@@ -188,43 +737,257 @@ public:
     }
 
 private:
-    pool_connection_type make_pool_connection_instance(std::shared_ptr<DBSession> const& session, id_t acquire_id, bool remove, typename pool_intern_item_type::clock_t::time_point started);
-    void release(DBSession* s);
+    /*!
+     * Waiting acquire request
+     *
+     * Waiters are queued by priority class and expiry time. The session is handed over to exactly one waiter
+     * which is woken up through its own condition variable (or resumed if it is a coroutine).
+     * When a connection is closed (or fails to connect) its slot is handed over instead and
+     * the waiter creates a new session itself.
+     */
+    struct waiter
+    {
+        id_t id_ {invalid_id};
+        time_point started_;
+        time_point expires_;
+        pool_priority priority_ {pool_priority::normal};
+        bool has_deadline_ {false};             // deadline set by caller (rejected early if not reachable)
+        pool_intern_item_type* item_ {nullptr}; // handed over session (set under main mutex)
+        bool reserved_ {false};                 // slot reserved for a new session (set under main mutex)
+        bool rejected_ {false};                 // failed by opened circuit (set under main mutex)
+        std::mutex mtx_;
+        std::condition_variable cv_;
+#ifdef DBM_COROUTINES
+        acquire_awaiter* co_ {nullptr};         // suspended coroutine
+#endif
+    };
+
+    struct job
+    {
+        virtual ~job() = default;
+        virtual void run(DBSession& s) = 0;
+        virtual void fail(std::exception_ptr e) = 0;
+    };
+
+    template<typename Result, typename Fn>
+    struct job_impl final : job
+    {
+        template<typename F>
+        explicit job_impl(F&& fn)
+            : fn_(std::forward<F>(fn))
+        {
+        }
+
+        void run(DBSession& s) override
+        {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    fn_(s);
+                    promise_.set_value();
+                }
+                else {
+                    promise_.set_value(fn_(s));
+                }
+            }
+            catch (...) {
+                promise_.set_exception(std::current_exception());
+            }
+        }
+
+        void fail(std::exception_ptr e) override
+        {
+            promise_.set_exception(std::move(e));
+        }
+
+        Fn fn_;
+        std::promise<Result> promise_;
+    };
+
+    struct waiter_order
+    {
+        bool operator()(waiter const* a, waiter const* b) const
+        {
+            return std::tie(a->priority_, a->expires_, a->id_) < std::tie(b->priority_, b->expires_, b->id_);
+        }
+    };
+
+    pool_intern_item_type* take_or_wait(waiter& w);
+    bool deadline_reachable(waiter const& w) const;
+    pool_intern_item_type* take_item(waiter& w);
+    pool_intern_item_type* create_item(id_t acquire_id);
+    pool_intern_item_type* pop_idle();
+    pool_intern_item_type* pop_valid_idle(std::optional<size_t> affinity_key = std::nullopt);
+    bool validate_idle(pool_intern_item_type* item);
+    pool_connection_type acquire_impl(pool_priority priority, time_point deadline, std::optional<size_t> affinity_key);
+    pool_connection_type acquire_session(pool_priority priority, time_point deadline, std::optional<size_t> affinity_key);
+    void remember_affinity(std::optional<size_t> affinity_key, pool_intern_item_type* item);
+    static size_t thread_affinity_key();
+    static size_t affinity_index(size_t affinity_key);
+    void push_idle(pool_intern_item_type* item);
+    bool check_session(pool_intern_item_type* item, std::string const& query);
+    void discard_item(pool_intern_item_type* item);
+    template<typename Fn>
+    static void run_parallel(size_t n, size_t max_threads, Fn const& fn);
+    waiter* erase_item(pool_intern_item_type* item);
+    waiter* release_slot();
+    void resume_waiter(waiter* w);
+    void on_acquired(pool_intern_item_type* item, id_t acquire_id, time_point started, pool_priority priority);
+    pool_connection_type make_pool_connection_instance(pool_intern_item_type* item, id_t acquire_id, time_point started, pool_priority priority);
+    void release(DBSession* s, pool_intern_item_type* item = nullptr);
+    void handover_idle();
+    void assign_caches(DBSession& s) const;
     void heartbeat_task();
-    void calculate_wait_time(typename pool_intern_item_type::clock_t::time_point tp1, typename pool_intern_item_type::clock_t::time_point tp2);
-    void remove_acquiring(id_t id);
+    std::chrono::milliseconds adjust_conn_limit();
+    void apply_conn_limit(size_t limit);
+    [[noreturn]] void reject_circuit_open(id_t acquire_id);
+    void on_session_success();
+    void on_session_failure();
+    void reject_waiters();
+    void probe_circuit();
+    void executor_task(size_t index);
+    void start_workers();
+    void resize_executor();
+    void stop_executor();
+    void prepare_statements(DBSession& s);
+    void prepare_idle_statements();
+    void push_acquiring(waiter* w);
+    waiter* pop_acquiring();
+    void remove_acquiring(waiter* w);
     void send_event(pool_event event, id_t id);
+    void dispatch_event(pool_event event, id_t id);
+    void event_dispatch_task();
+    static void update_max(std::atomic<size_t>& max, size_t value);
+    void wake_heartbeat(time_point at);
+#ifdef DBM_COROUTINES
+    bool co_acquire_begin(acquire_awaiter& w);
+    time_point expire_coro_waiters();
+    void cancel_coro_waiters();
+    void resume_coro_waiter(std::coroutine_handle<> h);
+#endif
 
     // Session
-    std::shared_mutex mutable mtx_;         // main control mutex
-    std::deque<id_t> acquiring_;
-    std::unordered_map<DBSession*, std::unique_ptr<pool_intern_item_type>> sessions_active_;
-    std::unordered_map<DBSession*, std::unique_ptr<pool_intern_item_type>> sessions_idle_;
-
-    // Handover
-    id_t ho_id_ {0};                        // handover id
-    std::shared_ptr<DBSession> ho_session_;   // handover session
-    std::condition_variable cv_ho_begin_;
-    std::mutex mutable mtx_cv_ho_begin_;    // mutex protecting cv_ho_begin_
-    std::condition_variable cv_ho_end_;
-    std::mutex mutable mtx_cv_ho_end_;      // mutex protecting cv_ho_end_
+    std::shared_mutex mutable mtx_;         // main control mutex (not used by idle stack fast path)
+    std::atomic<id_t> acquire_seq_ {0};
+    std::set<waiter*, waiter_order> acquiring_; // waiting acquire requests in service order
+    std::atomic<size_t> n_waiting_ {0};     // acquiring_ size, checked by fast path
+    std::array<size_t, n_priorities> n_acquiring_priority_ {}; // acquiring_ size by priority class
+    std::unordered_map<DBSession*, std::unique_ptr<pool_intern_item_type>> sessions_;
+    std::atomic<size_t> n_conn_ {0};        // sessions_ size including sessions being connected
+    detail::idle_stack<pool_intern_item_type> idle_;
+
+#ifdef DBM_COROUTINES
+    // Coroutines
+    std::unordered_map<id_t, acquire_awaiter*> co_waiters_; // suspended coroutines waiting for handover
+    coro_executor coro_executor_;
+#endif
 
     // Heartbeat
     std::thread thr_;
     std::atomic<bool> do_run_ {false};
     std::atomic<size_t> heartbeat_counter_ {0};
-    std::string heartbeat_query_ {"SELECT 1" };
-    std::chrono::milliseconds heartbeat_interval_ {5000};
+    std::string heartbeat_query_;           // empty - session ping
+    size_t heartbeat_parallelism_ {4};
+    std::atomic<std::chrono::milliseconds> heartbeat_interval_ {std::chrono::milliseconds(5000)};
     std::chrono::milliseconds heartbeat_sleep_time_normal_ {500};
     std::chrono::milliseconds heartbeat_sleep_time_lower_ {100};
+    std::mutex mtx_heartbeat_;
+    std::condition_variable cv_heartbeat_;
+    time_point heartbeat_wake_at_ {time_point::max()};  // time the background thread is sleeping until
+    bool heartbeat_wake_ {false};
 
     SessionInitializer make_session_;
-    EventCallback event_cb_;
-    bool event_cb_async_ {true};
     size_t max_conn_ {10};
+    std::atomic<size_t> conn_limit_ {10};   // effective limit (set under main mutex, checked by release without it)
     std::chrono::milliseconds acquire_timeout_ {5000};
+    std::atomic<size_t> min_idle_ {0};      // checked by the background thread without mutex
+    std::atomic<std::chrono::milliseconds> idle_timeout_ {std::chrono::milliseconds(0)};
+    std::atomic<std::chrono::milliseconds> max_lifetime_ {std::chrono::milliseconds(0)}; // checked by release without mutex
+    std::atomic<std::chrono::milliseconds> validation_interval_ {std::chrono::milliseconds(0)}; // checked by acquire without mutex
+
+    // Adaptive limit (controller state is used by the heartbeat thread only)
+    adaptive_limit_options adaptive_;
+    time_point adaptive_time_;
+    latency_histogram::snapshot adaptive_wait_;
+    latency_histogram::snapshot adaptive_query_;
+    std::chrono::nanoseconds latency_baseline_ {0};
+
+    // Admission control
+    size_t max_acquiring_ {0};
+    std::atomic<pool_circuit_state> circuit_ {pool_circuit_state::closed}; // checked by acquire without mutex
+    std::atomic<size_t> circuit_threshold_ {0};
+    std::atomic<std::chrono::milliseconds> circuit_open_time_ {std::chrono::milliseconds(5000)};
+    std::atomic<size_t> n_failures_ {0};    // consecutive connect and session check failures
+    std::atomic<time_point> circuit_opened_time_ {};
+
+    // Events
+    struct event_item
+    {
+        pool_event event {pool_event::acquired};
+        id_t id {invalid_id};
+    };
+
+    EventCallback event_cb_;
+    std::atomic<bool> event_cb_async_ {true};
+    std::atomic<bool> has_event_cb_ {false};
+    std::mutex mutable mtx_event_;          // mutex protecting event callback
+    detail::bounded_queue<event_item> events_ {event_queue_size};
+    std::thread event_thr_;                 // dispatcher thread
+    std::atomic<bool> event_run_ {true};
+    std::atomic<bool> event_thr_sleeping_ {false};
+    std::condition_variable cv_event_;
+    std::mutex mtx_cv_event_;               // mutex protecting cv_event_
+
+    // Executor
+    detail::bounded_queue<std::unique_ptr<job>> jobs_ {job_queue_size};
+    std::vector<std::thread> workers_;      // worker index is its position (never shrinks, see executor_task)
+    std::atomic<size_t> n_workers_ {0};
+    std::atomic<bool> workers_run_ {true};
+    std::atomic<size_t> n_workers_sleeping_ {0};
+    std::condition_variable cv_jobs_;       // workers waiting for jobs
+    std::condition_variable cv_workers_;    // workers parked above the connection limit
+    std::mutex mtx_jobs_;                   // mutex protecting workers_ and condition variables
+
+    // Registered statements
+    std::vector<std::string> statements_;   // statement per id (slot)
+    std::atomic<bool> statements_pending_ {false}; // registered statements not yet prepared by idle sessions
+    std::shared_mutex mutable mtx_statements_;
+
+    // Affinity
+    std::atomic<bool> affinity_ {false};
+    std::array<std::atomic<uint32_t>, size_t(1) << affinity_table_bits> affinity_slots_ {}; // idle stack slot + 1 per key hash
+
+    // Statistics (updated without main mutex)
+    std::atomic<size_t> stat_n_acquired_ {0};
+    std::atomic<size_t> stat_n_acquiring_max_ {0};
+    std::atomic<size_t> stat_n_max_conn_ {0};
+    std::atomic<size_t> stat_n_timeouts_ {0};
+    std::atomic<size_t> stat_n_rejected_ {0};
+    std::atomic<size_t> stat_n_events_dispatched_ {0};
+    std::atomic<size_t> stat_n_events_dropped_ {0};
+    std::atomic<size_t> stat_n_closed_idle_ {0};
+    std::atomic<size_t> stat_n_closed_lifetime_ {0};
+    std::atomic<size_t> stat_n_validations_ {0};
+    std::atomic<size_t> stat_n_validations_failed_ {0};
+    std::atomic<size_t> stat_n_limit_increased_ {0};
+    std::atomic<size_t> stat_n_limit_decreased_ {0};
+    std::atomic<size_t> stat_n_queue_full_ {0};
+    std::atomic<size_t> stat_n_circuit_opened_ {0};
+    std::atomic<size_t> stat_n_circuit_rejected_ {0};
+    std::atomic<size_t> stat_n_jobs_done_ {0};
+    std::atomic<size_t> stat_n_jobs_rejected_ {0};
+    std::atomic<size_t> stat_n_affinity_hits_ {0};
+    std::atomic<size_t> stat_n_affinity_misses_ {0};
     std::chrono::milliseconds stat_wait_step_ {100};
-    statistics stat_;
+    latency_histogram acquire_wait_;
+    std::array<latency_histogram, n_priorities> acquire_wait_priority_;
+    std::atomic<int64_t> hold_avg_ns_ {0}; // moving average of connection hold time
+    latency_histogram hold_time_;
+    std::shared_ptr<latency_histogram> query_time_ {std::make_shared<latency_histogram>()}; // shared with sessions
+
+    // Caches
+    std::shared_ptr<query_cache> query_cache_;
+    std::shared_ptr<identity_cache> identity_cache_;
+    std::mutex mutable mtx_caches_;         // mutex protecting caches (handover runs without main mutex)
 };
 
 template<typename DBSession, typename SessionInitializer>
@@ -234,226 +997,833 @@ pool<DBSession, SessionInitializer>::~pool()
 
     debug_log() << "Exit pool begin";
 
+    // Queued jobs are finished first
+    stop_executor();
+
     do_run_ = false;
+    wake_heartbeat(time_point::min());
 
     if (thr_.joinable())
         thr_.join();
 
+#ifdef DBM_COROUTINES
+    cancel_coro_waiters();
+#endif
+
     while (true) {
 
         std::unique_lock lock(mtx_);
-        if (sessions_active_.empty() && sessions_idle_.empty())
+
+        while (auto* item = idle_.pop()) {
+            erase_item(item);
+        }
+
+        if (n_conn_ == 0)
             break;
 
         debug_log() << "Exit pool : waiting connections to close";
 
-        if (!sessions_idle_.empty()) {
-            sessions_idle_.clear();
-        }
-
         lock.unlock();
 
         std::this_thread::sleep_for(1s);
     }
 
+    // Stop event dispatcher
+    event_run_ = false;
+    {
+        std::lock_guard lock(mtx_cv_event_);
+        event_thr_sleeping_ = false;
+        cv_event_.notify_one();
+    }
+    if (event_thr_.joinable())
+        event_thr_.join();
+
     debug_log() << "Exit pool end";
 }
 
 template<typename DBSession, typename SessionInitializer>
-typename pool<DBSession, SessionInitializer>::pool_connection_type
-pool<DBSession, SessionInitializer>::acquire()
+void pool<DBSession, SessionInitializer>::set_max_connections(size_t n)
 {
-    using clock_t = typename pool_intern_item_type::clock_t;
-    auto started = clock_t::now();
-    auto expires = started + acquire_timeout_;
-    id_t acquire_id;
-
-    // Lock mutex
-    std::unique_lock lock(mtx_);
-
-    // Acquire id
-    static id_t sid = invalid_id;
-    if (sid == invalid_id)
-        sid++;
-    acquire_id = sid++;
-    acquiring_.push_back(acquire_id);
-    if (acquiring_.size() > stat_.n_acquiring_max)
-        stat_.n_acquiring_max = acquiring_.size();
-
-    debug_log() << "acquiring #" << acquire_id << " total acquiring : " << acquiring_.size();
-
-    // Check existing connections
-    auto it_available = std::find_if(sessions_idle_.begin(), sessions_idle_.end(), [](auto const& it) {
-        return it.second->state_ == pool_intern_item_type::state::idle;
-    });
+    size_t limit;
+    {
+        std::lock_guard lock(mtx_);
+        max_conn_ = n;
+        limit = adaptive_.enabled ? std::clamp<size_t>(conn_limit_, std::min(adaptive_.min_conn, n), n) : n;
+    }
+    apply_conn_limit(limit);
+}
 
-    // If an idle session is available it will be reused
-    if (it_available != sessions_idle_.end()) {
-        auto* s = it_available->second->session_.get();
-        debug_log() << "Activating idle session #" << acquire_id << " (" << s << ")";
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::set_adaptive_limit(adaptive_limit_options const& options)
+{
+    size_t limit;
+    {
+        std::lock_guard lock(mtx_);
+        adaptive_ = options;
+        limit = options.enabled ? std::clamp<size_t>(n_conn_, std::min(options.min_conn, max_conn_), max_conn_) : max_conn_;
+    }
+    apply_conn_limit(limit);
+}
 
-        // change state
-        it_available->second->state_ = pool_intern_item_type::state::active;
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_connection_type
+pool<DBSession, SessionInitializer>::acquire_impl(pool_priority priority, time_point deadline, std::optional<size_t> affinity_key)
+{
+    auto conn = acquire_session(priority, deadline, affinity_key);
+    remember_affinity(affinity_key, conn.item_);
+    return conn;
+}
 
-        // move to active map
-        sessions_active_[s] = std::move(it_available->second);
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_connection_type
+pool<DBSession, SessionInitializer>::acquire_session(pool_priority priority, time_point deadline, std::optional<size_t> affinity_key)
+{
+    using clock_t = typename pool_intern_item_type::clock_t;
+    auto started = clock_t::now();
+    id_t acquire_id = acquire_seq_++;
 
-        // remove from idle map
-        sessions_idle_.erase(it_available);
+    if (circuit_.load(std::memory_order_relaxed) != pool_circuit_state::closed) {
+        reject_circuit_open(acquire_id);
+    }
 
-        // return connection object
-        return make_pool_connection_instance(sessions_active_[s]->session_, acquire_id, true, started);
+    // Fast path - reuse an idle session without locking if nobody is waiting
+    if (n_waiting_ == 0) {
+        if (auto* item = pop_valid_idle(affinity_key)) {
+            return make_pool_connection_instance(item, acquire_id, started, priority);
+        }
     }
 
-    // If all connections are active we need to wait for one
-    if (sessions_active_.size() + sessions_idle_.size() >= max_conn_) {
+    // Lock mutex
+    std::unique_lock lock(mtx_);
 
-        // Handover session pointer
-        std::shared_ptr<DBSession> sh;
+    // Reuse an idle session or create a new one if the pool is not full
+    waiter w;
+    w.id_ = acquire_id;
+    w.started_ = started;
+    w.expires_ = std::min(deadline, started + acquire_timeout_);
+    w.priority_ = priority;
+    w.has_deadline_ = deadline != time_point::max();
 
-        // Lock handover begin condition variable
-        std::unique_lock cv_lk(mtx_cv_ho_begin_);
+    if (auto* item = take_or_wait(w)) {
+        return make_pool_connection_instance(item, acquire_id, started, priority);
+    }
 
-        // Unlock main mutex
-        lock.unlock();
+    // All connections are active so we need to wait for one to be handed over
+    bool reserved = w.reserved_;
+    lock.unlock();
 
-        // Wait for a free connection with timeout
-        bool r = cv_ho_begin_.wait_until(cv_lk, expires, [this, acquire_id, &sh] {
-            if (ho_session_ && acquire_id == ho_id_) {
-                //debug_log() << "check #" << acquire_id << " ho_id_ " << ho_id_ << " true";
-                sh = std::move(ho_session_);
-                return true;
-            }
-            else {
-                //debug_log() << "check #" << acquire_id << " ho_id_ " << ho_id_ << " false";
-                return false;
-            }
+    if (!reserved) {
+        std::unique_lock w_lock(w.mtx_);
+        bool r = w.cv_.wait_until(w_lock, w.expires_, [&w] {
+            return w.item_ != nullptr || w.reserved_ || w.rejected_;
         });
+        w_lock.unlock();
 
-        if (r) {
-            // Session acquired successfully
-            debug_log() << "handover session #" << acquire_id << " (" << sh.get() << ")";
-
-            // Notify releaser
-            std::lock_guard lock_ho(mtx_cv_ho_end_);
-            cv_ho_end_.notify_all();
-            //debug_log() << "handover session #" << acquire_id << " notified (" << sh.get() << ")";
-
-            // Return connection object
-            return make_pool_connection_instance(sh, acquire_id, false, started);
-        }
-        else {
+        if (!r) {
             // Handle acquire timeout
-
-            // Remove acquire id from queue and throw exception
             lock.lock();
-            if (sessions_active_.size() + sessions_idle_.size() >= max_conn_) {
-                stat_.n_timeouts++;
-                remove_acquiring(acquire_id);
 
-                send_event(pool_event::timeout, acquire_id);
-                throw_exception("Connection acquire timeout");
-            }
-            else {
+            // Session or slot could be handed over (or the request rejected) before the main mutex was locked
+            if (!w.item_ && !w.reserved_ && !w.rejected_) {
+                // Remove acquire request from queue
+                remove_acquiring(&w);
+
                 // In case there are free connection available could be that heartbeat query failed
-                // and session was deleted from session_active_
-                goto Make_new_session;
+                // and session was deleted
+                if (auto* item = take_item(w)) {
+                    return make_pool_connection_instance(item, acquire_id, started, priority);
+                }
+
+                if (!w.reserved_) {
+                    stat_n_timeouts_++;
+                    send_event(pool_event::timeout, acquire_id);
+                    throw_exception("Connection acquire timeout");
+                }
             }
+
+            lock.unlock();
+        }
+
+        if (w.rejected_) {
+            throw_exception<pool_circuit_open_error>("Connection acquire rejected - circuit open");
         }
     }
 
-    Make_new_session:
+    // Slot reserved - connect without main mutex
+    if (!w.item_) {
+        return make_pool_connection_instance(create_item(acquire_id), acquire_id, started, priority);
+    }
 
-    // Create session
-    auto* new_intern_item = new pool_intern_item(make_session_());
-    auto* ptr = new_intern_item->session_.get();
-    sessions_active_[ptr] = std::unique_ptr<pool_intern_item_type>(new_intern_item);
-    debug_log() << "Creating session #" << acquire_id << " (" << ptr << ")";
+    // Session acquired successfully (acquire is already recorded by releaser)
+    debug_log() << "handover session #" << acquire_id << " (" << w.item_->session_.get() << ")";
 
     // Return connection object
-    return make_pool_connection_instance(new_intern_item->session_, acquire_id, true, started);
+    assign_caches(*w.item_->session_);
+    return { *this, w.item_->session_, w.item_ };
 }
 
 template<typename DBSession, typename SessionInitializer>
-typename pool<DBSession, SessionInitializer>::pool_connection_type
-pool<DBSession, SessionInitializer>::make_pool_connection_instance(std::shared_ptr<DBSession> const& session, id_t acquire_id, bool remove, typename pool_intern_item_type::clock_t::time_point started)
+template<typename Fn>
+std::future<std::invoke_result_t<Fn&, DBSession&>> pool<DBSession, SessionInitializer>::submit(Fn&& fn)
 {
-    if (sessions_active_.size() > stat_.n_max_conn)
-        stat_.n_max_conn = sessions_active_.size();
-    ++stat_.n_acquired;
-    calculate_wait_time(started, pool_intern_item_type::clock_t::now());
-    if (remove)
-        remove_acquiring(acquire_id);
+    using result_type = std::invoke_result_t<Fn&, DBSession&>;
 
-    send_event(pool_event::acquired, acquire_id);
+    auto j = std::make_unique<job_impl<result_type, std::decay_t<Fn>>>(std::forward<Fn>(fn));
+    auto result = j->promise_.get_future();
+
+    start_workers();
 
-    return { *this, session };
+    if (!jobs_.try_push(std::unique_ptr<job>(std::move(j)))) {
+        ++stat_n_jobs_rejected_;
+        send_event(pool_event::queue_full, invalid_id);
+        throw_exception<pool_queue_full_error>("Job rejected - job queue full");
+    }
+
+    // Wake up a worker only if some are waiting for jobs
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (n_workers_sleeping_.load(std::memory_order_relaxed)) {
+        std::lock_guard lock(mtx_jobs_);
+        cv_jobs_.notify_one();
+    }
+
+    return result;
 }
 
 template<typename DBSession, typename SessionInitializer>
-void pool<DBSession, SessionInitializer>::release(DBSession* s)
+void pool<DBSession, SessionInitializer>::executor_task(size_t index)
 {
-    std::unique_lock lck(mtx_, std::defer_lock);
-    std::unique_lock lck_ho_begin(mtx_cv_ho_begin_, std::defer_lock);
-    std::lock(lck, lck_ho_begin);
+    std::unique_ptr<job> j;
 
-    debug_log() << "Release session begin (" << s << ")";
+    // the first worker is never parked, so queued jobs are always served
+    auto parked = [this, index] { return index >= std::max<size_t>(conn_limit_, 1); };
 
-    auto it = sessions_active_.find(s);
-    if (it != sessions_active_.end()) {
-        it->second->heartbeat_time_ = pool_intern_item_type::clock_t::now();
+    while (true) {
+        if (parked()) {
+            std::unique_lock lock(mtx_jobs_);
+            cv_workers_.wait(lock, [&] { return !parked() || !workers_run_; });
+            if (!workers_run_)
+                break;
+            continue;
+        }
 
-        if (!acquiring_.empty() && it->second->session_->is_connected()) {
-            // Begin handover
-            auto id = acquiring_.front();
-            ho_id_ = id;
-            ho_session_ = it->second->session_;
-            acquiring_.pop_front();
-            debug_log() << "session handover to #" << id << " (" << s << ")";
+        if (!jobs_.try_pop(j)) {
+            std::unique_lock lock(mtx_jobs_);
 
-            // Lock handover end condition variable
-            std::unique_lock lck_ho_end(mtx_cv_ho_end_);
-            cv_ho_begin_.notify_all();
-            lck_ho_begin.unlock();
+            // Producers check the counter after pushing a job
+            ++n_workers_sleeping_;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cv_jobs_.wait(lock, [&] { return !jobs_.empty() || parked() || !workers_run_; });
+            --n_workers_sleeping_;
 
-            //debug_log() << "session handover to #" << id << " wait begin (" << s << ")";
-            send_event(pool_event::handover, id);
+            // Queued jobs are done before exit
+            if (!workers_run_ && jobs_.empty())
+                break;
+            continue;
+        }
 
-            // Wait acquiring thread to finish handover and block another releases to prevent modifying ho_session while acquiring tasks waiting in queue
-            cv_ho_end_.wait(lck_ho_end);
-            //debug_log() << "session handover to #" << id << " wait finished (" << s << ")";
+        // Connection is kept while there are queued jobs
+        try {
+            auto conn = acquire();
+            do {
+                j->run(conn.get());
+                j.reset();
+                ++stat_n_jobs_done_;
+            } while (!parked() && jobs_.try_pop(j));
         }
-        else {
-            // No waiting tasks - move connection to idle map
-            it->second->state_ = pool_intern_item_type::state::idle;
-            if (it->second->session_->is_connected()) {
-                sessions_idle_[s] = std::move(it->second);
+        catch (...) {
+            if (j) {
+                j->fail(std::current_exception());
+                j.reset();
             }
-            sessions_active_.erase(it);
-            debug_log() << "session released (" << s << ") - total active : " << sessions_active_.size() << " total idle : " << sessions_idle_.size();
         }
     }
-    else {
-        throw_exception("No such connection to release"); // TODO: maybe just quiet exit without exception?
-    }
 }
 
 template<typename DBSession, typename SessionInitializer>
-void pool<DBSession, SessionInitializer>::heartbeat_task()
+void pool<DBSession, SessionInitializer>::start_workers()
 {
-    using namespace std::chrono_literals;
+    size_t n = std::max<size_t>(conn_limit_, 1);
+    if (n_workers_.load(std::memory_order_acquire) >= n)
+        return;
 
-    using clock_t = typename pool_intern_item_type::clock_t;
+    std::lock_guard lock(mtx_jobs_);
+    if (!workers_run_)
+        return;
 
-    // initial sleep
-    auto sleep_time = heartbeat_sleep_time_normal_;
+    while (workers_.size() < n) {
+        size_t index = workers_.size();
+        workers_.emplace_back([this, index] { executor_task(index); });
+    }
+    n_workers_.store(workers_.size(), std::memory_order_release);
+}
 
-    while (do_run_) {
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::resize_executor()
+{
+    // executor is started by the first submit
+    if (n_workers_.load(std::memory_order_acquire) == 0)
+        return;
 
-        std::this_thread::sleep_for(sleep_time);
+    start_workers();
 
-        if (heartbeat_interval_ == 0s)
-            continue;
+    // workers above the new limit are parked, the ones below it are resumed
+    std::lock_guard lock(mtx_jobs_);
+    cv_jobs_.notify_all();
+    cv_workers_.notify_all();
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::stop_executor()
+{
+    {
+        std::lock_guard lock(mtx_jobs_);
+        workers_run_ = false;
+        cv_jobs_.notify_all();
+        cv_workers_.notify_all();
+    }
+
+    for (auto& it : workers_) {
+        it.join();
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_intern_item_type*
+pool<DBSession, SessionInitializer>::take_or_wait(waiter& w)
+{
+    // Others are already waiting - keep the order
+    if (acquiring_.empty()) {
+        if (auto* item = take_item(w); item || w.reserved_)
+            return item;
+    }
+
+    if (max_acquiring_ && acquiring_.size() >= max_acquiring_) {
+        stat_n_queue_full_++;
+        send_event(pool_event::queue_full, w.id_);
+        throw_exception<pool_queue_full_error>("Connection acquire rejected - wait queue full");
+    }
+
+    push_acquiring(&w);
+
+    // A session could be released by the fast path before the waiter was published,
+    // so the first waiter checks the idle stack once again (later ones are served by handover)
+    if (*acquiring_.begin() == &w) {
+        if (auto* item = pop_idle()) {
+            remove_acquiring(&w);
+            return item;
+        }
+    }
+
+    if (w.has_deadline_ && !deadline_reachable(w)) {
+        remove_acquiring(&w);
+        stat_n_rejected_++;
+        send_event(pool_event::rejected, w.id_);
+        throw_exception("Connection acquire rejected - deadline cannot be met");
+    }
+
+    return nullptr;
+}
+
+template<typename DBSession, typename SessionInitializer>
+bool pool<DBSession, SessionInitializer>::deadline_reachable(waiter const& w) const
+{
+    auto now = pool_intern_item_type::clock_t::now();
+    if (w.expires_ <= now)
+        return false;
+
+    // unknown until a connection is released
+    auto hold_avg = hold_avg_ns_.load(std::memory_order_relaxed);
+    if (hold_avg <= 0)
+        return true;
+
+    // connections are expected to be released evenly, one per hold_avg / n_conn,
+    // so max_served waiters (including this one) are served before the deadline
+    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(w.expires_ - now).count();
+    auto n_conn = static_cast<int64_t>(std::max<size_t>(n_conn_, 1));
+    auto max_served = static_cast<size_t>(remaining / hold_avg * n_conn + remaining % hold_avg * n_conn / hold_avg);
+
+    // waiters of higher priority classes are ahead, the same class ones only with an earlier deadline
+    auto priority = static_cast<size_t>(w.priority_);
+    size_t ahead = 0;
+    for (size_t i = 0; i < priority; ++i) {
+        ahead += n_acquiring_priority_[i];
+    }
+
+    if (ahead >= max_served)
+        return false;
+    if (ahead + n_acquiring_priority_[priority] <= max_served)
+        return true;
+
+    // walk is bounded by the number of waiters served before the deadline, not by the queue length
+    for (auto it = acquiring_.find(const_cast<waiter*>(&w)); it != acquiring_.begin();) {
+        if ((*--it)->priority_ != w.priority_)
+            break;
+        if (++ahead >= max_served)
+            return false;
+    }
+
+    return true;
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_intern_item_type*
+pool<DBSession, SessionInitializer>::take_item(waiter& w)
+{
+    // If an idle session is available it will be reused
+    if (auto* item = pop_idle()) {
+        debug_log() << "Activating idle session #" << w.id_ << " (" << item->session_.get() << ")";
+        return item;
+    }
+
+    if (n_conn_ >= conn_limit_) {
+        return nullptr;
+    }
+
+    // Reserve a slot, the session is created by create_item after the main mutex is unlocked
+    ++n_conn_;
+    w.reserved_ = true;
+    return nullptr;
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_intern_item_type*
+pool<DBSession, SessionInitializer>::create_item(id_t acquire_id)
+{
+    // Main mutex is not locked while connecting, so a slow connect does not block other acquirers
+    std::unique_ptr<pool_intern_item_type> new_intern_item;
+    try {
+        new_intern_item = std::make_unique<pool_intern_item_type>(make_session_());
+        new_intern_item->session_->set_query_histogram(query_time_);
+        prepare_statements(*new_intern_item->session_);
+        new_intern_item->slot_ = idle_.attach(new_intern_item.get());
+    }
+    catch (...) {
+        // waiters are failed first if the circuit opens, so the slot is not handed over to them
+        on_session_failure();
+
+        waiter* w;
+        {
+            std::lock_guard lock(mtx_);
+            w = release_slot();
+        }
+        resume_waiter(w);
+        throw;
+    }
+
+    on_session_success();
+
+    // Publish session
+    auto* item = new_intern_item.get();
+    {
+        std::lock_guard lock(mtx_);
+        sessions_[item->session_.get()] = std::move(new_intern_item);
+    }
+    debug_log() << "Creating session #" << acquire_id << " (" << item->session_.get() << ")";
+
+    return item;
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_intern_item_type*
+pool<DBSession, SessionInitializer>::pop_idle()
+{
+    auto* item = idle_.pop();
+    if (item) {
+        item->state_ = pool_intern_item_type::state::active;
+    }
+    return item;
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::push_idle(pool_intern_item_type* item)
+{
+    item->state_ = pool_intern_item_type::state::idle;
+    idle_.push(item->slot_);
+
+    // Acquiring tasks which started waiting before the push are served by handover
+    if (n_waiting_ > 0) {
+        handover_idle();
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_intern_item_type*
+pool<DBSession, SessionInitializer>::pop_valid_idle(std::optional<size_t> affinity_key)
+{
+    // preferred session is taken from the idle stack if it is there
+    if (affinity_key) {
+        auto slot = affinity_slots_[affinity_index(*affinity_key)].load(std::memory_order_relaxed);
+        auto* item = slot ? idle_.take(slot - 1) : nullptr;
+
+        if (item) {
+            item->state_ = pool_intern_item_type::state::active;
+            if (validate_idle(item)) {
+                ++stat_n_affinity_hits_;
+                return item;
+            }
+        }
+        ++stat_n_affinity_misses_;
+    }
+
+    while (auto* item = pop_idle()) {
+        if (validate_idle(item)) {
+            return item;
+        }
+    }
+
+    return nullptr;
+}
+
+template<typename DBSession, typename SessionInitializer>
+bool pool<DBSession, SessionInitializer>::validate_idle(pool_intern_item_type* item)
+{
+    auto interval = validation_interval_.load();
+
+    // sessions used (or checked) recently are not validated
+    if (interval == std::chrono::milliseconds(0)
+        || pool_intern_item_type::clock_t::now() - item->heartbeat_time_ <= interval) {
+        return true;
+    }
+
+    ++stat_n_validations_;
+    if (check_session(item, {})) {
+        return true;
+    }
+
+    ++stat_n_validations_failed_;
+    discard_item(item);
+    return false;
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::remember_affinity(std::optional<size_t> affinity_key, pool_intern_item_type* item)
+{
+    if (affinity_key && item) {
+        affinity_slots_[affinity_index(*affinity_key)].store(item->slot_ + 1, std::memory_order_relaxed);
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+size_t pool<DBSession, SessionInitializer>::thread_affinity_key()
+{
+    return std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+template<typename DBSession, typename SessionInitializer>
+size_t pool<DBSession, SessionInitializer>::affinity_index(size_t affinity_key)
+{
+    // Fibonacci hashing - thread id hashes are usually aligned addresses
+    return static_cast<size_t>((static_cast<uint64_t>(affinity_key) * 0x9E3779B97F4A7C15ull) >> (64 - affinity_table_bits));
+}
+
+template<typename DBSession, typename SessionInitializer>
+bool pool<DBSession, SessionInitializer>::check_session(pool_intern_item_type* item, std::string const& query)
+{
+    try {
+        // ping does not need a result set, custom query is expected to return rows
+        if (query.empty() ? item->session_->ping() : !item->session_->select(query).empty()) {
+            on_session_success();
+            return true;
+        }
+
+        error_log() << "Session check failed " << item->session_.get();
+    }
+    catch (std::exception& e) {
+        error_log() << "Session check error " << item->session_.get() << " : " << e.what();
+    }
+
+    on_session_failure();
+    return false;
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::discard_item(pool_intern_item_type* item)
+{
+    // session is closed after the mutex is unlocked
+    auto session = item->session_;
+    waiter* w;
+    {
+        std::lock_guard lock(mtx_);
+        w = erase_item(item);
+    }
+    session.reset();
+    resume_waiter(w);
+}
+
+template<typename DBSession, typename SessionInitializer>
+template<typename Fn>
+void pool<DBSession, SessionInitializer>::run_parallel(size_t n, size_t max_threads, Fn const& fn)
+{
+    std::atomic<size_t> next {0};
+    auto work = [&] {
+        for (size_t i; (i = next++) < n;) {
+            fn(i);
+        }
+    };
+
+    // the calling thread is one of the workers
+    std::vector<std::future<void>> workers;
+    for (size_t i = 1; i < std::min(n, max_threads); ++i) {
+        workers.push_back(std::async(std::launch::async, work));
+    }
+
+    work();
+
+    for (auto& it : workers) {
+        it.wait();
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::waiter*
+pool<DBSession, SessionInitializer>::erase_item(pool_intern_item_type* item)
+{
+    debug_log() << "Remove session " << item->session_.get();
+    idle_.detach(item->slot_);
+    sessions_.erase(item->session_.get());
+    return release_slot();
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::waiter*
+pool<DBSession, SessionInitializer>::release_slot()
+{
+    // the slot is not handed over while the pool is above its (lowered) limit
+    if (acquiring_.empty() || n_conn_ > conn_limit_) {
+        --n_conn_;
+        return nullptr;
+    }
+
+    // Hand the slot over to the first waiter which creates a new session
+    auto* w = pop_acquiring();
+    debug_log() << "slot handover to #" << w->id_;
+
+#ifdef DBM_COROUTINES
+    if (w->co_) {
+        w->reserved_ = true;
+        co_waiters_.erase(w->id_);
+        return w; // resumed by the caller after the main mutex is unlocked
+    }
+#endif
+
+    std::lock_guard w_lock(w->mtx_);
+    w->reserved_ = true;
+    w->cv_.notify_one();
+    return nullptr;
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::resume_waiter([[maybe_unused]] waiter* w)
+{
+#ifdef DBM_COROUTINES
+    if (w) {
+        resume_coro_waiter(w->co_->handle_);
+    }
+#endif
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::on_acquired(pool_intern_item_type* item, id_t acquire_id, time_point started, pool_priority priority)
+{
+    auto now = pool_intern_item_type::clock_t::now();
+    item->acquired_time_ = now;
+
+    update_max(stat_n_max_conn_, num_active_connections());
+    ++stat_n_acquired_;
+    acquire_wait_.record(now - started);
+    acquire_wait_priority_[static_cast<size_t>(priority)].record(now - started);
+
+    send_event(pool_event::acquired, acquire_id);
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::pool_connection_type
+pool<DBSession, SessionInitializer>::make_pool_connection_instance(pool_intern_item_type* item, id_t acquire_id, time_point started, pool_priority priority)
+{
+    on_acquired(item, acquire_id, started, priority);
+
+    // session is not used by anyone else until returned
+    assign_caches(*item->session_);
+
+    return { *this, item->session_, item };
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::assign_caches(DBSession& s) const
+{
+    std::lock_guard lock(mtx_caches_);
+    s.set_query_cache(query_cache_);
+    s.set_identity_cache(identity_cache_);
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::release(DBSession* s, pool_intern_item_type* item)
+{
+    if (!item) {
+        std::shared_lock lock(mtx_);
+        auto it = sessions_.find(s);
+        if (it == sessions_.end()) {
+            throw_exception("No such connection to release"); // TODO: maybe just quiet exit without exception?
+        }
+        item = it->second.get();
+    }
+
+    auto now = pool_intern_item_type::clock_t::now();
+    if (item->state_ == pool_intern_item_type::state::active) {
+        auto hold = now - item->acquired_time_;
+        hold_time_.record(hold);
+        item->released_time_ = now;
+
+        // exponential moving average (weight 1/8), concurrent updates may be lost
+        auto hold_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(hold).count();
+        auto hold_avg = hold_avg_ns_.load(std::memory_order_relaxed);
+        hold_avg_ns_.store(hold_avg ? hold_avg + (hold_ns - hold_avg) / 8 : hold_ns, std::memory_order_relaxed);
+    }
+    item->heartbeat_time_ = now;
+
+    auto max_lifetime = max_lifetime_.load();
+    bool expired = max_lifetime.count() && now - item->created_time_ > max_lifetime;
+    if (expired) {
+        ++stat_n_closed_lifetime_;
+    }
+
+    if (!item->session_->is_connected() || expired || n_conn_ > conn_limit_) {
+        // Closed and expired sessions are not reused, nor the ones above the connection limit
+        discard_item(item);
+        return;
+    }
+
+    // Fast path - push to idle stack
+    push_idle(item);
+}
+
+template<typename DBSession, typename SessionInitializer>
+size_t pool<DBSession, SessionInitializer>::warm_up()
+{
+    // Reserve slots for missing idle connections
+    size_t n = 0;
+    {
+        std::lock_guard lock(mtx_);
+        while (idle_.size() + n < min_idle_ && n_conn_ < conn_limit_) {
+            ++n_conn_;
+            ++n;
+        }
+    }
+
+    if (n == 0)
+        return 0;
+
+    // Connect in parallel
+    std::atomic<size_t> n_created {0};
+
+    run_parallel(n, n, [this, &n_created](size_t) {
+        try {
+            auto* item = create_item(invalid_id);
+            item->released_time_ = item->heartbeat_time_ = pool_intern_item_type::clock_t::now();
+            push_idle(item);
+            ++n_created;
+        }
+        catch (std::exception& e) {
+            error_log() << "Warm up error : " << e.what();
+        }
+    });
+
+    debug_log() << "Warm up created " << n_created << " sessions";
+    return n_created;
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::handover_idle()
+{
+#ifdef DBM_COROUTINES
+    std::vector<acquire_awaiter*> resumed;
+#endif
+
+    {
+        std::lock_guard lock(mtx_);
+
+        while (!acquiring_.empty()) {
+            auto* item = pop_idle();
+            if (!item)
+                break;
+
+            // Hand the session over to the first waiter
+            auto* w = pop_acquiring();
+            debug_log() << "session handover to #" << w->id_ << " (" << item->session_.get() << ")";
+            send_event(pool_event::handover, w->id_);
+            on_acquired(item, w->id_, w->started_, w->priority_);
+
+#ifdef DBM_COROUTINES
+            if (w->co_) {
+                w->item_ = item;
+                co_waiters_.erase(w->id_);
+                resumed.push_back(w->co_);
+                continue;
+            }
+#endif
+
+            // waiter may return as soon as its mutex is unlocked
+            std::lock_guard w_lock(w->mtx_);
+            w->item_ = item;
+            w->cv_.notify_one();
+        }
+    }
+
+#ifdef DBM_COROUTINES
+    for (auto* w : resumed) {
+        resume_coro_waiter(w->handle_);
+    }
+#endif
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::heartbeat_task()
+{
+    using namespace std::chrono_literals;
+
+    using clock_t = typename pool_intern_item_type::clock_t;
+
+    // initial sleep
+    auto sleep_time = heartbeat_sleep_time_normal_;
+
+    // time until the next adaptive limit decision (0 - disabled)
+    auto adaptive_next = 0ms;
+
+    while (do_run_) {
+
+        auto run_at = clock_t::now() + (adaptive_next != 0ms ? std::min(sleep_time, adaptive_next) : sleep_time);
+
+        // coroutine waiters are not blocked on a timed wait, so the thread also wakes up when
+        // the earliest one expires (and when a waiter is queued) to resume the expired ones
+        while (do_run_) {
+#ifdef DBM_COROUTINES
+            auto co_next = expire_coro_waiters();
+#else
+            auto co_next = time_point::max();
+#endif
+            auto wake_at = std::min(run_at, co_next);
+            if (clock_t::now() >= run_at)
+                break;
+
+            std::unique_lock lock(mtx_heartbeat_);
+            heartbeat_wake_at_ = wake_at;
+            if (!heartbeat_wake_)
+                cv_heartbeat_.wait_until(lock, wake_at);
+            heartbeat_wake_ = false;
+            heartbeat_wake_at_ = time_point::max();
+        }
+
+        if (!do_run_)
+            break;
+
+        adaptive_next = adjust_conn_limit();
+        probe_circuit();
+        prepare_idle_statements();
+
+        auto heartbeat_interval = heartbeat_interval_.load();
+        bool heartbeat = heartbeat_interval != 0s;
+        if (!heartbeat && !min_idle_ && idle_timeout_.load() == 0s && max_lifetime_.load() == 0s)
+            continue;
 
         // try to lock mutex
         if (mtx_.try_lock()) {
@@ -462,67 +1832,112 @@ void pool<DBSession, SessionInitializer>::heartbeat_task()
             // find items and perform heartbeat query if necessary
             std::vector<pool_intern_item_type*> items;
 
-            auto heartbeat_candidate = [this]() {
-                for (auto it = sessions_idle_.begin(); it != sessions_idle_.end(); ++it) {
-                    if (it->second->state_ == pool_intern_item_type::state::idle && clock_t::now() - it->second->heartbeat_time_ > heartbeat_interval_) {
-                        return it;
-                    }
+            // idle sessions are taken from the stack and the ones not due for heartbeat are returned;
+            // slow path acquire is blocked by the main mutex meanwhile so no session is created instead
+            std::vector<pool_intern_item_type*> items_idle;
+            std::vector<std::shared_ptr<DBSession>> sessions_closed;
+            std::vector<waiter*> resumed;
+            auto now = clock_t::now();
+            auto max_lifetime = max_lifetime_.load();
+            auto idle_timeout = idle_timeout_.load();
+            size_t min_idle = min_idle_;
+            auto heartbeat_query = heartbeat_query_;
+            auto heartbeat_parallelism = heartbeat_parallelism_;
+            size_t n_popped = 0;
+
+            while (n_popped < n_conn_) {
+                auto* it = idle_.pop();
+                if (!it)
+                    break;
+                ++n_popped;
+
+                // the stack top is the most recently used session, so the ones idle for
+                // the longest time are closed while min_idle sessions above them are kept
+                bool expired = max_lifetime != 0s && now - it->created_time_ > max_lifetime;
+                bool idle_expired = idle_timeout != 0s && now - it->released_time_ > idle_timeout
+                                    && items.size() + items_idle.size() >= min_idle;
+
+                if (expired || idle_expired) {
+                    ++(expired ? stat_n_closed_lifetime_ : stat_n_closed_idle_);
+                    debug_log() << "Closing " << (expired ? "expired" : "idle") << " session " << it->session_.get();
+                    // session is closed after the mutex is unlocked
+                    sessions_closed.push_back(it->session_);
+                    if (auto* w = erase_item(it))
+                        resumed.push_back(w);
                 }
-                return sessions_idle_.end();
-            };
-
-            typename decltype(sessions_idle_)::iterator iter;
-
-            while ((iter = heartbeat_candidate()) != sessions_idle_.end()) {
-                auto* s = iter->first;
-                iter->second->state_ = pool_intern_item_type::state::pending_heartbeat;
-                sessions_active_[s] = std::move(iter->second);
-                sessions_idle_.erase(iter);
-                items.push_back(sessions_active_[s].get());
+                else if (heartbeat && now - it->heartbeat_time_ > heartbeat_interval) {
+                    it->state_ = pool_intern_item_type::state::pending_heartbeat;
+                    items.push_back(it);
+                }
+                else {
+                    items_idle.push_back(it);
+                }
+            }
 
+            // keep the order of idle sessions
+            for (auto it = items_idle.rbegin(); it != items_idle.rend(); ++it) {
+                idle_.push((*it)->slot_);
             }
 
             // Unlock mutex and perform heartbeats
             // we don't need mutex lock as sessions on which heartbeat will be
-            // performed already have state pending_heartbeat
+            // performed are not in the idle stack
             mtx_.unlock();
 
+            sessions_closed.clear();
+            for (auto* w : resumed) {
+                resume_waiter(w);
+            }
+
+            // sessions are checked in parallel, each one by a single thread
+            std::vector<char> alive(items.size(), 0);
+
+            run_parallel(items.size(), heartbeat_parallelism, [&](size_t i) {
+                alive[i] = check_session(items[i], heartbeat_query);
+            });
+
             std::vector<pool_intern_item_type*> items_failed;
             items_failed.reserve(items.size());
             std::vector<pool_intern_item_type*> items_success;
             items_success.reserve(items.size());
 
-            for (auto* it : items) {
-                try {
-                    debug_log() << "Performing heartbeat session " << it->session_.get();
-                    // TODO: custom executor instead of select statement
-                    if (!it->session_->select(heartbeat_query_).empty()) {
-                        it->heartbeat_time_ = clock_t::now();
-                        ++heartbeat_counter_;
-                        items_success.push_back(it);
-                    }
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (alive[i]) {
+                    ++heartbeat_counter_;
                     send_event(pool_event::heartbeat_success, invalid_id);
+                    items_success.push_back(items[i]);
                 }
-                catch (std::exception& e) {
+                else {
                     send_event(pool_event::heartbeat_fail, invalid_id);
-                    error_log() << "Heartbeat error session " << it->session_.get() << " : " << e.what();
-                    it->state_ = pool_intern_item_type::state::canceled;
-                    items_failed.push_back(it);
+                    items[i]->state_ = pool_intern_item_type::state::canceled;
+                    items_failed.push_back(items[i]);
                 }
             }
 
             if (!items_failed.empty()) {
-                // remove items from idle session list
-                std::lock_guard lock_erasing(mtx_);
+                // remove failed sessions
+                resumed.clear();
+                {
+                    std::lock_guard lock_erasing(mtx_);
+
+                    for (auto* it : items_failed) {
+                        if (auto* w = erase_item(it))
+                            resumed.push_back(w);
+                    }
+                }
 
-                for (auto* it : items_failed) {
-                    debug_log() << "Remove session " << it->session_.get();
-                    sessions_active_.erase(it->session_.get());
+                for (auto* w : resumed) {
+                    resume_waiter(w);
                 }
             }
 
             for (auto* it : items_success) {
-                release(it->session_.get());
+                release(it->session_.get(), it);
+            }
+
+            // replace closed sessions
+            if (min_idle) {
+                warm_up();
             }
 
             sleep_time = heartbeat_sleep_time_normal_;
@@ -536,45 +1951,627 @@ void pool<DBSession, SessionInitializer>::heartbeat_task()
 }
 
 template<typename DBSession, typename SessionInitializer>
-void pool<DBSession, SessionInitializer>::calculate_wait_time(typename pool_intern_item_type::clock_t::time_point tp1, typename pool_intern_item_type::clock_t::time_point tp2)
+void pool<DBSession, SessionInitializer>::wake_heartbeat(time_point at)
 {
-    long dur = std::chrono::duration_cast<std::chrono::milliseconds>(tp2 - tp1).count();
-    long range = dur / stat_wait_step_.count();
-    long rem = dur % stat_wait_step_.count();
-    range *= stat_wait_step_.count();
-    if (rem)
-        range += stat_wait_step_.count();
-    if (range == 0)
-        range = 1;
-    stat_.acquire_stat[range]++;
+    {
+        std::lock_guard lock(mtx_heartbeat_);
+        // the thread is woken only if it would sleep past the time
+        if (at >= heartbeat_wake_at_)
+            return;
+        heartbeat_wake_ = true;
+    }
+    cv_heartbeat_.notify_one();
 }
 
 template<typename DBSession, typename SessionInitializer>
-void pool<DBSession, SessionInitializer>::remove_acquiring(id_t id)
+std::chrono::milliseconds pool<DBSession, SessionInitializer>::adjust_conn_limit()
 {
-    for (auto it = acquiring_.begin(); it != acquiring_.end(); ++it) {
-        if (*it == id) {
-            acquiring_.erase(it);
-            break;
+    using namespace std::chrono_literals;
+
+    adaptive_limit_options opts;
+    size_t max_conn;
+    {
+        std::shared_lock lock(mtx_);
+        opts = adaptive_;
+        max_conn = max_conn_;
+    }
+
+    if (!opts.enabled)
+        return 0ms;
+
+    auto now = pool_intern_item_type::clock_t::now();
+    if (now - adaptive_time_ < opts.interval)
+        return std::max(std::chrono::ceil<std::chrono::milliseconds>(adaptive_time_ + opts.interval - now), 1ms);
+    adaptive_time_ = now;
+
+    // percentiles of the last interval
+    auto wait = acquire_wait_.snap();
+    auto query = query_time_->snap();
+    auto wait_p90 = wait.since(adaptive_wait_).percentile(0.9);
+    auto query_interval = query.since(adaptive_query_);
+    adaptive_wait_ = std::move(wait);
+    adaptive_query_ = std::move(query);
+
+    // the baseline follows the median slowly, so a lasting change of the workload is accepted
+    bool saturated = false;
+    if (query_interval.count) {
+        auto latency = query_interval.percentile(0.5);
+        latency_baseline_ = latency_baseline_ == 0ns || latency < latency_baseline_
+                                ? latency
+                                : latency_baseline_ + (latency - latency_baseline_) / 32;
+        saturated = latency > latency_baseline_ * opts.latency_tolerance;
+    }
+
+    size_t limit = conn_limit_;
+    size_t new_limit = limit;
+
+    if (saturated) {
+        // multiplicative decrease, at least by one
+        if (limit > opts.min_conn) {
+            auto backoff = static_cast<size_t>(static_cast<double>(limit) * opts.backoff);
+            new_limit = std::max(opts.min_conn, std::min(limit - 1, backoff));
         }
     }
+    else if ((n_waiting_ > 0 || wait_p90 > opts.target_wait) && n_conn_ >= limit && limit < max_conn) {
+        // additive increase
+        new_limit = limit + 1;
+    }
+
+    if (new_limit != limit) {
+        debug_log() << "Connection limit " << limit << " -> " << new_limit;
+        apply_conn_limit(new_limit);
+        ++(new_limit > limit ? stat_n_limit_increased_ : stat_n_limit_decreased_);
+        send_event(new_limit > limit ? pool_event::limit_increased : pool_event::limit_decreased, invalid_id);
+    }
+
+    return opts.interval;
 }
 
 template<typename DBSession, typename SessionInitializer>
-void pool<DBSession, SessionInitializer>::send_event(pool_event event, id_t id)
+void pool<DBSession, SessionInitializer>::apply_conn_limit(size_t limit)
+{
+    std::vector<std::shared_ptr<DBSession>> sessions_closed;
+    std::vector<waiter*> resumed;
+    {
+        std::lock_guard lock(mtx_);
+        conn_limit_ = std::min(limit, max_conn_);
+
+        // new slots are handed over to waiting requests
+        while (n_conn_ < conn_limit_ && !acquiring_.empty()) {
+            ++n_conn_;
+            if (auto* w = release_slot())
+                resumed.push_back(w);
+        }
+
+        // idle sessions above the limit are closed (active ones when released)
+        while (n_conn_ > conn_limit_) {
+            auto* item = idle_.pop();
+            if (!item)
+                break;
+            // session is closed after the mutex is unlocked
+            sessions_closed.push_back(item->session_);
+            if (auto* w = erase_item(item))
+                resumed.push_back(w);
+        }
+    }
+
+    sessions_closed.clear();
+    for (auto* w : resumed) {
+        resume_waiter(w);
+    }
+
+    resize_executor();
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::reject_circuit_open(id_t acquire_id)
+{
+    stat_n_circuit_rejected_++;
+    send_event(pool_event::circuit_rejected, acquire_id);
+    throw_exception<pool_circuit_open_error>("Connection acquire rejected - circuit open");
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::on_session_success()
+{
+    n_failures_.store(0, std::memory_order_relaxed);
+
+    // only the probe succeeds while half open
+    auto state = pool_circuit_state::half_open;
+    if (circuit_.compare_exchange_strong(state, pool_circuit_state::closed)) {
+        debug_log() << "Circuit closed";
+        send_event(pool_event::circuit_closed, invalid_id);
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::on_session_failure()
 {
-    if (event_cb_) {
-        if (event_cb_async_) {
-            std::thread([event, id, cb = event_cb_] {
-                cb(event, id);
-            }).detach();
+    auto threshold = circuit_threshold_.load();
+    auto n = ++n_failures_;
+    if (!threshold)
+        return;
+
+    // failed probe opens the circuit again regardless of the count
+    auto state = circuit_.load();
+    if ((state == pool_circuit_state::closed && n >= threshold) || state == pool_circuit_state::half_open) {
+        if (circuit_.compare_exchange_strong(state, pool_circuit_state::open)) {
+            circuit_opened_time_ = pool_intern_item_type::clock_t::now();
+            ++stat_n_circuit_opened_;
+            error_log() << "Circuit opened after " << n << " consecutive failures";
+            send_event(pool_event::circuit_opened, invalid_id);
+            reject_waiters();
+        }
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::reject_waiters()
+{
+    std::vector<waiter*> resumed;
+    {
+        std::lock_guard lock(mtx_);
+
+        while (!acquiring_.empty()) {
+            auto* w = pop_acquiring();
+            stat_n_circuit_rejected_++;
+            send_event(pool_event::circuit_rejected, w->id_);
+
+#ifdef DBM_COROUTINES
+            if (w->co_) {
+                co_waiters_.erase(w->id_);
+                try {
+                    throw_exception<pool_circuit_open_error>("Connection acquire rejected - circuit open");
+                }
+                catch (...) {
+                    w->co_->error_ = std::current_exception();
+                }
+                resumed.push_back(w);
+                continue;
+            }
+#endif
+
+            std::lock_guard w_lock(w->mtx_);
+            w->rejected_ = true;
+            w->cv_.notify_one();
+        }
+    }
+
+    for (auto* w : resumed) {
+        resume_waiter(w);
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::probe_circuit()
+{
+    if (circuit_ != pool_circuit_state::open
+        || pool_intern_item_type::clock_t::now() - circuit_opened_time_.load() < circuit_open_time_.load())
+        return;
+
+    auto state = pool_circuit_state::open;
+    if (!circuit_.compare_exchange_strong(state, pool_circuit_state::half_open))
+        return;
+
+    debug_log() << "Circuit half open - probing";
+    send_event(pool_event::circuit_half_opened, invalid_id);
+
+    // probe with an idle session (result closes or opens the circuit)
+    if (auto* item = pop_idle()) {
+        if (check_session(item, {})) {
+            push_idle(item);
         }
         else {
-            event_cb_(event, id);
+            discard_item(item);
+        }
+        return;
+    }
+
+    bool reserved = false;
+    {
+        std::lock_guard lock(mtx_);
+        if (n_conn_ < conn_limit_) {
+            ++n_conn_;
+            reserved = true;
+        }
+    }
+
+    if (!reserved) {
+        // all sessions are in use, probe again later
+        state = pool_circuit_state::half_open;
+        if (circuit_.compare_exchange_strong(state, pool_circuit_state::open))
+            circuit_opened_time_ = pool_intern_item_type::clock_t::now();
+        return;
+    }
+
+    // probe with a new connection which is kept idle
+    try {
+        auto* item = create_item(invalid_id);
+        item->released_time_ = item->heartbeat_time_ = pool_intern_item_type::clock_t::now();
+        push_idle(item);
+    }
+    catch (std::exception& e) {
+        error_log() << "Circuit probe error : " << e.what();
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::prepare_statements(DBSession& s)
+{
+    std::shared_lock lock(mtx_statements_);
+
+    for (size_t i = 0; i < statements_.size(); ++i) {
+        // already prepared statements are only looked up by slot
+        try {
+            kind::prepared_statement stmt(statements_[i]);
+            kind::prepared_statement_manipulator(stmt).set_slot(i);
+            s.init_prepared_statement(stmt);
+        }
+        catch (std::exception& e) {
+            // prepared again on first use
+            error_log() << "Prepare registered statement error : " << e.what();
+        }
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::prepare_idle_statements()
+{
+    if (!statements_pending_.exchange(false))
+        return;
+
+    // idle sessions are taken from the stack, so nobody else uses them meanwhile;
+    // slow path acquire is blocked while popping so no session is created instead
+    std::vector<pool_intern_item_type*> items;
+    {
+        std::lock_guard lock(mtx_);
+        while (items.size() < n_conn_) {
+            auto* item = idle_.pop();
+            if (!item)
+                break;
+            item->state_ = pool_intern_item_type::state::pending_heartbeat;
+            items.push_back(item);
+        }
+    }
+
+    for (auto* item : items) {
+        prepare_statements(*item->session_);
+    }
+
+    // keep the order of idle sessions
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+        release((*it)->session_.get(), *it);
+    }
+
+    debug_log() << "Registered statements prepared by " << items.size() << " idle sessions";
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::push_acquiring(waiter* w)
+{
+    acquiring_.insert(w);
+    n_waiting_ = acquiring_.size();
+    ++n_acquiring_priority_[static_cast<size_t>(w->priority_)];
+    update_max(stat_n_acquiring_max_, acquiring_.size());
+
+    debug_log() << "acquiring #" << w->id_ << " total acquiring : " << acquiring_.size();
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::waiter*
+pool<DBSession, SessionInitializer>::pop_acquiring()
+{
+    auto* w = *acquiring_.begin();
+    acquiring_.erase(acquiring_.begin());
+    n_waiting_ = acquiring_.size();
+    --n_acquiring_priority_[static_cast<size_t>(w->priority_)];
+    return w;
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::remove_acquiring(waiter* w)
+{
+    if (acquiring_.erase(w))
+        --n_acquiring_priority_[static_cast<size_t>(w->priority_)];
+    n_waiting_ = acquiring_.size();
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::send_event(pool_event event, id_t id)
+{
+    if (!has_event_cb_)
+        return;
+
+    if (!event_cb_async_) {
+        dispatch_event(event, id);
+        return;
+    }
+
+    if (!events_.try_push({event, id})) {
+        ++stat_n_events_dropped_;
+        return;
+    }
+
+    // Wake up dispatcher only if it's waiting for events
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (event_thr_sleeping_.load(std::memory_order_relaxed)) {
+        std::lock_guard lock(mtx_cv_event_);
+        event_thr_sleeping_ = false;
+        cv_event_.notify_one();
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::dispatch_event(pool_event event, id_t id)
+{
+    EventCallback cb;
+    {
+        std::lock_guard lock(mtx_event_);
+        cb = event_cb_;
+    }
+
+    if (cb) {
+        try {
+            cb(event, id);
+        }
+        catch (std::exception& e) {
+            error_log() << "Event callback error : " << e.what();
+        }
+        ++stat_n_events_dispatched_;
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::event_dispatch_task()
+{
+    event_item e;
+
+    while (true) {
+        while (events_.try_pop(e)) {
+            dispatch_event(e.event, e.id);
+        }
+
+        std::unique_lock lock(mtx_cv_event_);
+
+        // Producers check the flag after pushing an event
+        event_thr_sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (events_.try_pop(e)) {
+            event_thr_sleeping_ = false;
+            lock.unlock();
+            dispatch_event(e.event, e.id);
+            continue;
+        }
+
+        if (!event_run_)
+            break;
+
+        cv_event_.wait(lock, [this] { return !event_thr_sleeping_ || !event_run_; });
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::update_max(std::atomic<size_t>& max, size_t value)
+{
+    size_t prev = max.load(std::memory_order_relaxed);
+    while (prev < value && !max.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+    }
+}
+
+#ifdef DBM_COROUTINES
+
+/*!
+ * Awaitable returned by pool::co_acquire
+ *
+ * The coroutine is suspended only when all connections are active. It is resumed with the
+ * session directly from pool::release (or from the heartbeat thread on timeout), using the
+ * pool coroutine executor if set.
+ */
+template<typename DBSession, typename SessionInitializer>
+class pool<DBSession, SessionInitializer>::acquire_awaiter
+{
+    friend class pool;
+public:
+    acquire_awaiter(pool& p, pool_priority priority, time_point deadline)
+        : pool_(p)
+        , deadline_(deadline)
+    {
+        waiter_.priority_ = priority;
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        handle_ = h;
+        waiter_.co_ = this;
+        return pool_.co_acquire_begin(*this);
+    }
+
+    pool_connection_type await_resume()
+    {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+
+        // Slot reserved - connect in the resumed coroutine
+        if (!waiter_.item_) {
+            waiter_.item_ = pool_.create_item(waiter_.id_);
+            pool_.on_acquired(waiter_.item_, waiter_.id_, waiter_.started_, waiter_.priority_);
         }
+
+        auto* item = waiter_.item_;
+        pool_.remember_affinity(affinity_key_, item);
+        pool_.assign_caches(*item->session_);
+        return { pool_, item->session_, item };
     }
+
+private:
+    pool& pool_;
+    waiter waiter_;
+    std::coroutine_handle<> handle_;
+    time_point deadline_;
+    std::optional<size_t> affinity_key_;
+    std::exception_ptr error_;
+};
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::acquire_awaiter
+pool<DBSession, SessionInitializer>::co_acquire(pool_priority priority, time_point deadline)
+{
+    return acquire_awaiter(*this, priority, deadline);
 }
 
+template<typename DBSession, typename SessionInitializer>
+bool pool<DBSession, SessionInitializer>::co_acquire_begin(acquire_awaiter& w)
+{
+    w.waiter_.started_ = pool_intern_item_type::clock_t::now();
+    w.waiter_.id_ = acquire_seq_++;
+
+    if (circuit_.load(std::memory_order_relaxed) != pool_circuit_state::closed) {
+        reject_circuit_open(w.waiter_.id_);
+    }
+
+    // Fast path - reuse an idle session without locking if nobody is waiting
+    w.affinity_key_ = affinity_ ? std::optional(thread_affinity_key()) : std::nullopt;
+
+    if (n_waiting_ == 0 && (w.waiter_.item_ = pop_valid_idle(w.affinity_key_))) {
+        on_acquired(w.waiter_.item_, w.waiter_.id_, w.waiter_.started_, w.waiter_.priority_);
+        return false; // do not suspend
+    }
+
+    std::unique_lock lock(mtx_);
+
+    w.waiter_.expires_ = std::min(w.deadline_, w.waiter_.started_ + acquire_timeout_);
+    w.waiter_.has_deadline_ = w.deadline_ != time_point::max();
+
+    // Reuse an idle session or create a new one if the pool is not full
+    if ((w.waiter_.item_ = take_or_wait(w.waiter_))) {
+        on_acquired(w.waiter_.item_, w.waiter_.id_, w.waiter_.started_, w.waiter_.priority_);
+        return false; // do not suspend
+    }
+
+    if (w.waiter_.reserved_) {
+        lock.unlock();
+        w.waiter_.item_ = create_item(w.waiter_.id_);
+        on_acquired(w.waiter_.item_, w.waiter_.id_, w.waiter_.started_, w.waiter_.priority_);
+        return false; // do not suspend
+    }
+
+    // Suspend until the session is handed over by pool::release, the background thread
+    // resumes it on expiry
+    co_waiters_[w.waiter_.id_] = &w;
+    wake_heartbeat(w.waiter_.expires_);
+    return true;
+}
+
+template<typename DBSession, typename SessionInitializer>
+typename pool<DBSession, SessionInitializer>::time_point pool<DBSession, SessionInitializer>::expire_coro_waiters()
+{
+    std::vector<acquire_awaiter*> resumed;
+    auto next = time_point::max();
+
+    {
+        std::lock_guard lock(mtx_);
+
+        if (co_waiters_.empty())
+            return next;
+
+        auto now = pool_intern_item_type::clock_t::now();
+
+        for (auto it = co_waiters_.begin(); it != co_waiters_.end();) {
+            auto* w = it->second;
+
+            if (now < w->waiter_.expires_) {
+                next = std::min(next, w->waiter_.expires_);
+                ++it;
+                continue;
+            }
+
+            it = co_waiters_.erase(it);
+            resumed.push_back(w);
+
+            try {
+                remove_acquiring(&w->waiter_);
+
+                // In case there are free connection available could be that heartbeat query failed
+                // and session was deleted
+                if ((w->waiter_.item_ = take_item(w->waiter_))) {
+                    on_acquired(w->waiter_.item_, w->waiter_.id_, w->waiter_.started_, w->waiter_.priority_);
+                    continue;
+                }
+
+                // session is created when resumed
+                if (w->waiter_.reserved_)
+                    continue;
+
+                stat_n_timeouts_++;
+                send_event(pool_event::timeout, w->waiter_.id_);
+                throw_exception("Connection acquire timeout");
+            }
+            catch (...) {
+                w->error_ = std::current_exception();
+            }
+        }
+
+    }
+
+    for (auto* w : resumed) {
+        resume_coro_waiter(w->handle_);
+    }
+
+    return next;
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::cancel_coro_waiters()
+{
+    std::vector<acquire_awaiter*> canceled;
+
+    {
+        std::lock_guard lock(mtx_);
+
+        for (auto& it : co_waiters_) {
+            auto* w = it.second;
+            remove_acquiring(&w->waiter_);
+
+            try {
+                throw_exception("Connection acquire canceled - pool destroyed");
+            }
+            catch (...) {
+                w->error_ = std::current_exception();
+            }
+
+            canceled.push_back(w);
+        }
+
+        co_waiters_.clear();
+    }
+
+    for (auto* w : canceled) {
+        resume_coro_waiter(w->handle_);
+    }
+}
+
+template<typename DBSession, typename SessionInitializer>
+void pool<DBSession, SessionInitializer>::resume_coro_waiter(std::coroutine_handle<> h)
+{
+    auto executor = get_coro_executor();
+
+    if (executor) {
+        executor([h] { h.resume(); });
+    }
+    else {
+        h.resume();
+    }
+}
+
+#endif //DBM_COROUTINES
+
 } // namespace dbm
 
 #endif //DBM_POOL_HPP
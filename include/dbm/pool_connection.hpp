@@ -2,21 +2,26 @@
 #define DBM_POOL_CONNECTION_HPP
 
 #include <dbm/session.hpp>
+#include <dbm/coro.hpp>
+#include <utility>
 
 namespace dbm {
 
 template<typename PoolType>
 class DBM_EXPORT pool_connection
 {
+    friend PoolType;
 public:
     using pool_type = PoolType;
     using db_session_type = typename PoolType::db_session_type;
+    using pool_intern_item_type = typename PoolType::pool_intern_item_type;
 
     pool_connection() = delete;
 
-    pool_connection(pool_type& pool, std::shared_ptr<db_session_type> p)
+    pool_connection(pool_type& pool, std::shared_ptr<db_session_type> p, pool_intern_item_type* item = nullptr)
         : pool_(pool)
         , session_(std::move(p))
+        , item_(item)
     {
     }
 
@@ -25,6 +30,7 @@ public:
     pool_connection(pool_connection&& oth) noexcept
         : pool_(oth.pool_)
         , session_(std::move(oth.session_))
+        , item_(std::exchange(oth.item_, nullptr))
     {
     }
 
@@ -50,6 +56,7 @@ public:
             if (&pool_ == &oth.pool_) {
                 // move is only possible if not the same instance and connections belong to the same pool
                 session_ = std::move(oth.session_);
+                item_ = std::exchange(oth.item_, nullptr);
             }
             else {
                 // reset the oth connection
@@ -96,18 +103,75 @@ public:
         return session_ != nullptr;
     }
 
+#ifdef DBM_COROUTINES
+    // awaitable operations - performed on the pool coroutine executor (if set)
+    auto co_query(std::string statement)
+    {
+        return detail::coro_operation(pool_.get_coro_executor(), [db = &get(), statement = std::move(statement)] {
+            db->query(statement);
+        });
+    }
+
+    auto co_query(kind::prepared_statement& stmt)
+    {
+        return detail::coro_operation(pool_.get_coro_executor(), [db = &get(), &stmt] {
+            db->query(stmt);
+        });
+    }
+
+    auto co_select(std::string statement)
+    {
+        return detail::coro_operation(pool_.get_coro_executor(), [db = &get(), statement = std::move(statement)] {
+            return db->select(statement);
+        });
+    }
+
+    auto co_select(kind::prepared_statement& stmt)
+    {
+        return detail::coro_operation(pool_.get_coro_executor(), [db = &get(), &stmt] {
+            return db->select(stmt);
+        });
+    }
+
+    template<typename Model>
+    auto co_write(Model& m)
+    {
+        return detail::coro_operation(pool_.get_coro_executor(), [db = &get(), &m] {
+            m.write_record(*db);
+        });
+    }
+
+    template<typename Model>
+    auto co_read(Model& m, std::string extra_condition = "")
+    {
+        return detail::coro_operation(pool_.get_coro_executor(), [db = &get(), &m, extra_condition = std::move(extra_condition)] {
+            m.read_record(*db, extra_condition);
+        });
+    }
+
+    template<typename Model>
+    auto co_delete(Model& m)
+    {
+        return detail::coro_operation(pool_.get_coro_executor(), [db = &get(), &m] {
+            m.delete_record(*db);
+        });
+    }
+#endif
+
     // releases db session
     void release()
     {
         if (session_) {
-            pool_.release(session_.get());
+            pool_.release(session_.get(), item_);
             session_ = nullptr;
+            item_ = nullptr;
         }
     }
 
 private:
     pool_type& pool_;
     std::shared_ptr<db_session_type> session_;
+    pool_intern_item_type* item_ {nullptr};  // pool bookkeeping item (released without lookup)
 };
 
 } // namespace dbm
@@ -3,6 +3,7 @@
 
 #include "session.hpp"
 #include <chrono>
+#include <cstdint>
 
 namespace dbm {
 
@@ -23,12 +24,17 @@ public:
     explicit pool_intern_item(std::shared_ptr<DBSession>&& s)
         : session_(std::move(s))
         , state_(state::active)
+        , created_time_(clock_t::now())
     {
     }
 
     state state_ {state::idle};
     std::shared_ptr<DBSession> session_;
     clock_t::time_point heartbeat_time_;
+    clock_t::time_point acquired_time_;
+    clock_t::time_point released_time_; // last time returned to the idle stack
+    clock_t::time_point created_time_;
+    uint32_t slot_ {0};                 // idle stack slot
 };
 
 } // namespace dbm
@@ -9,6 +9,7 @@ class prepared_statement
 {
     friend class prepared_statement_manipulator;
 public:
+    static constexpr size_t no_slot = static_cast<size_t>(-1);
 
     template<typename ...Args>
     explicit prepared_statement(std::string stmt, Args&&... args)
@@ -54,6 +55,11 @@ public:
 
     auto native_handle() { return native_handle_; }
 
+    /*!
+     * Session handle slot of a statement registered on a pool (no_slot - handle is looked up by statement)
+     */
+    size_t slot() const { return slot_; }
+
     template<typename DBType>
     prepared_statement& operator>>(DBType& s);
 
@@ -72,6 +78,7 @@ private:
     std::vector<container*> parms_;
     std::vector<container_ptr> parms_local_;
     void* native_handle_ {nullptr};
+    size_t slot_ {no_slot};
 };
 
 class prepared_statement_manipulator
@@ -83,6 +90,8 @@ public:
 
     void set_native_handle(void* p) { ps_.native_handle_ = p; }
 
+    void set_slot(size_t slot) { ps_.slot_ = slot; }
+
 private:
     prepared_statement& ps_;
 };
@@ -0,0 +1,705 @@
+#ifndef DBM_QUERY_CACHE_HPP
+#define DBM_QUERY_CACHE_HPP
+
+#include <dbm/dbm_common.hpp>
+#include <dbm/sql_types.hpp>
+#include <dbm/prepared_statement.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <variant>
+
+namespace dbm {
+
+namespace detail {
+
+/*!
+ * Statement tables and kind as needed by the query cache
+ *
+ * This is a lightweight tokenizer, not a SQL parser. Statements it does not recognize
+ * are never cached, and unrecognized writes invalidate the whole cache.
+ */
+struct statement_info
+{
+    bool cacheable {false};           // single deterministic SELECT / WITH statement reading tables
+    bool invalidate_all {false};      // write with unknown target (e.g. CALL, USE, LOAD DATA)
+    bool begin_transaction {false};
+    bool end_transaction {false};
+    std::vector<std::string> read_tables;
+    std::vector<std::string> write_tables;
+};
+
+DBM_INLINE statement_info parse_statement_info(std::string_view sql);
+
+/*!
+ * Table name without database prefix and quotes (lower case)
+ */
+DBM_INLINE std::string normalize_table_name(std::string_view table);
+
+} // namespace detail
+
+/*!
+ * Read-through query result cache
+ *
+ * Results are keyed by statement text (and prepared statement parameters) and stored as
+ * sql_rows_dump snapshots, so a hit only restores pointers into the cached arena.
+ * Entries expire after ttl and the least recently used ones are evicted when the size
+ * budget is exceeded. Writes executed through a session using the cache (query(),
+ * model::write_record(), model::delete_record(), ...) invalidate entries reading the
+ * tables named by the write statement. Writes from other processes are only bounded by ttl,
+ * as are tables written by triggers and base tables of views (a select from a view is not
+ * invalidated by writes to its base tables).
+ *
+ * The cache is thread safe and is usually shared by all sessions of a pool
+ * (see pool::set_query_cache()).
+ */
+class DBM_EXPORT query_cache
+{
+public:
+    using clock_t = std::chrono::steady_clock;
+    using prepared_rows = std::vector<std::vector<container_ptr>>;
+
+    struct config
+    {
+        std::chrono::milliseconds ttl {std::chrono::seconds(5)};
+        size_t max_bytes {64 * 1024 * 1024};
+    };
+
+    struct statistics
+    {
+        uint64_t hits {0};
+        uint64_t misses {0};
+        uint64_t evictions {0};     // removed to stay within size budget
+        uint64_t expirations {0};   // removed after ttl
+        uint64_t invalidations {0}; // removed by writes
+        size_t entries {0};
+        size_t bytes {0};
+    };
+
+    query_cache();
+
+    explicit query_cache(config cfg);
+
+    query_cache(query_cache const&) = delete;
+
+    query_cache& operator=(query_cache const&) = delete;
+
+    /*!
+     * Returns cached result or calls fetch() and caches its result
+     *
+     * Only single SELECT statements reading tables, without non-deterministic or session dependent
+     * functions, are cached (see detail::parse_statement_info()).
+     *
+     * @param statement select statement
+     * @param fetch function executing the statement
+     */
+    template<typename Fn>
+    kind::sql_rows select(std::string_view statement, Fn&& fetch);
+
+    template<typename Fn>
+    prepared_rows select(kind::prepared_statement& stmt, Fn&& fetch);
+
+    /*!
+     * Removes all entries reading the table
+     */
+    void invalidate(std::string_view table);
+
+    void invalidate_all();
+
+    /*!
+     * Invalidates tables written by statement
+     */
+    void invalidate(detail::statement_info const& info);
+
+    void clear();
+
+    config get_config() const;
+
+    void set_config(config cfg);
+
+    statistics stat() const;
+
+    void reset_stat();
+
+private:
+    struct entry
+    {
+        std::string key;
+        std::variant<kind::sql_rows_dump, prepared_rows> value;
+        std::vector<std::string> tables;
+        clock_t::time_point expires;
+        size_t bytes {0};
+    };
+
+    using lru_list = std::list<std::shared_ptr<entry>>;
+
+    // table generations captured before a statement is executed - results are not
+    // stored if any of the tables was invalidated in the meantime
+    struct ticket
+    {
+        uint64_t all_gen;
+        uint64_t tables_gen;
+    };
+
+    std::shared_ptr<entry> find(std::string const& key);
+    ticket make_ticket(std::vector<std::string> const& tables) const;
+    void insert(std::shared_ptr<entry> e, ticket t);
+    void erase(lru_list::iterator it);
+    static std::string prepared_key(kind::prepared_statement& stmt);
+    static size_t entry_size(entry const& e);
+
+    mutable std::mutex mtx_;
+    config cfg_;
+    statistics stat_;
+    lru_list lru_;                                                   // most recently used first
+    std::unordered_map<std::string, lru_list::iterator> entries_;
+    std::unordered_map<std::string, std::vector<std::string>> tables_; // table -> entry keys
+    std::unordered_map<std::string, uint64_t> table_gen_;
+    uint64_t all_gen_ {0};
+};
+
+DBM_INLINE query_cache::query_cache()
+    : query_cache(config {})
+{
+}
+
+DBM_INLINE query_cache::query_cache(config cfg)
+    : cfg_(cfg)
+{
+}
+
+template<typename Fn>
+DBM_INLINE kind::sql_rows query_cache::select(std::string_view statement, Fn&& fetch)
+{
+    // statements which are not cached do not touch the cache (nor its statistics)
+    auto info = detail::parse_statement_info(statement);
+    if (!info.cacheable)
+        return fetch();
+
+    std::string key(statement);
+
+    if (auto e = find(key)) {
+        // entry is immutable - restore only sets pointers into the shared arena
+        return std::get<kind::sql_rows_dump>(e->value).restore();
+    }
+
+    auto t = make_ticket(info.read_tables);
+    kind::sql_rows rows = fetch();
+
+    auto e = std::make_shared<entry>();
+    e->key = std::move(key);
+    e->value = kind::sql_rows_dump(rows);
+    e->tables = std::move(info.read_tables);
+    insert(std::move(e), t);
+
+    return rows;
+}
+
+template<typename Fn>
+DBM_INLINE query_cache::prepared_rows query_cache::select(kind::prepared_statement& stmt, Fn&& fetch)
+{
+    auto info = detail::parse_statement_info(stmt.statement());
+    if (!info.cacheable)
+        return fetch();
+
+    std::string key = prepared_key(stmt);
+
+    auto clone_rows = [](prepared_rows const& src) {
+        prepared_rows dest;
+        dest.reserve(src.size());
+        for (auto const& src_row : src) {
+            auto& row = dest.emplace_back();
+            row.reserve(src_row.size());
+            for (auto const& c : src_row) {
+                row.push_back(c->clone());
+            }
+        }
+        return dest;
+    };
+
+    if (auto e = find(key)) {
+        return clone_rows(std::get<prepared_rows>(e->value));
+    }
+
+    auto t = make_ticket(info.read_tables);
+    prepared_rows rows = fetch();
+
+    auto e = std::make_shared<entry>();
+    e->key = std::move(key);
+    e->value = clone_rows(rows);
+    e->tables = std::move(info.read_tables);
+    insert(std::move(e), t);
+
+    return rows;
+}
+
+DBM_INLINE void query_cache::invalidate(std::string_view table)
+{
+    std::lock_guard lock(mtx_);
+
+    auto name = detail::normalize_table_name(table);
+    ++table_gen_[name];
+
+    auto it = tables_.find(name);
+    if (it == tables_.end())
+        return;
+
+    auto keys = std::move(it->second);
+    tables_.erase(it);
+
+    for (auto const& k : keys) {
+        auto e = entries_.find(k);
+        if (e != entries_.end()) {
+            erase(e->second);
+            ++stat_.invalidations;
+        }
+    }
+}
+
+DBM_INLINE void query_cache::invalidate_all()
+{
+    std::lock_guard lock(mtx_);
+    ++all_gen_;
+    stat_.invalidations += entries_.size();
+    lru_.clear();
+    entries_.clear();
+    tables_.clear();
+    stat_.entries = 0;
+    stat_.bytes = 0;
+}
+
+DBM_INLINE void query_cache::invalidate(detail::statement_info const& info)
+{
+    if (info.invalidate_all) {
+        invalidate_all();
+        return;
+    }
+    for (auto const& t : info.write_tables) {
+        invalidate(t);
+    }
+}
+
+DBM_INLINE void query_cache::clear()
+{
+    std::lock_guard lock(mtx_);
+    ++all_gen_;
+    lru_.clear();
+    entries_.clear();
+    tables_.clear();
+    stat_.entries = 0;
+    stat_.bytes = 0;
+}
+
+DBM_INLINE query_cache::config query_cache::get_config() const
+{
+    std::lock_guard lock(mtx_);
+    return cfg_;
+}
+
+DBM_INLINE void query_cache::set_config(config cfg)
+{
+    std::lock_guard lock(mtx_);
+    cfg_ = cfg;
+    while (stat_.bytes > cfg_.max_bytes && !lru_.empty()) {
+        erase(std::prev(lru_.end()));
+        ++stat_.evictions;
+    }
+}
+
+DBM_INLINE query_cache::statistics query_cache::stat() const
+{
+    std::lock_guard lock(mtx_);
+    return stat_;
+}
+
+DBM_INLINE void query_cache::reset_stat()
+{
+    std::lock_guard lock(mtx_);
+    stat_.hits = 0;
+    stat_.misses = 0;
+    stat_.evictions = 0;
+    stat_.expirations = 0;
+    stat_.invalidations = 0;
+}
+
+DBM_INLINE std::shared_ptr<query_cache::entry> query_cache::find(std::string const& key)
+{
+    std::lock_guard lock(mtx_);
+
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        ++stat_.misses;
+        return nullptr;
+    }
+
+    auto e = *it->second;
+    if (clock_t::now() >= e->expires) {
+        erase(it->second);
+        ++stat_.expirations;
+        ++stat_.misses;
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++stat_.hits;
+    return e;
+}
+
+DBM_INLINE query_cache::ticket query_cache::make_ticket(std::vector<std::string> const& tables) const
+{
+    std::lock_guard lock(mtx_);
+
+    ticket t {all_gen_, 0};
+    for (auto const& table : tables) {
+        auto it = table_gen_.find(detail::normalize_table_name(table));
+        if (it != table_gen_.end())
+            t.tables_gen += it->second;
+    }
+    return t;
+}
+
+DBM_INLINE void query_cache::insert(std::shared_ptr<entry> e, ticket t)
+{
+    for (auto& table : e->tables) {
+        table = detail::normalize_table_name(table);
+    }
+    e->bytes = entry_size(*e);
+
+    std::lock_guard lock(mtx_);
+
+    // generations only grow - a different sum means a table was written meanwhile
+    uint64_t gen = 0;
+    for (auto const& table : e->tables) {
+        auto it = table_gen_.find(table);
+        if (it != table_gen_.end())
+            gen += it->second;
+    }
+    if (t.all_gen != all_gen_ || t.tables_gen != gen)
+        return;
+
+    if (e->bytes > cfg_.max_bytes || cfg_.ttl.count() <= 0)
+        return;
+
+    if (auto it = entries_.find(e->key); it != entries_.end()) {
+        erase(it->second);
+    }
+
+    while (stat_.bytes + e->bytes > cfg_.max_bytes && !lru_.empty()) {
+        erase(std::prev(lru_.end()));
+        ++stat_.evictions;
+    }
+
+    e->expires = clock_t::now() + cfg_.ttl;
+    for (auto const& table : e->tables) {
+        tables_[table].push_back(e->key);
+    }
+
+    stat_.bytes += e->bytes;
+    ++stat_.entries;
+    lru_.push_front(e);
+    entries_[e->key] = lru_.begin();
+}
+
+DBM_INLINE void query_cache::erase(lru_list::iterator it)
+{
+    auto const& e = **it;
+
+    for (auto const& table : e.tables) {
+        auto t = tables_.find(table);
+        if (t != tables_.end()) {
+            auto& keys = t->second;
+            keys.erase(std::remove(keys.begin(), keys.end(), e.key), keys.end());
+            if (keys.empty())
+                tables_.erase(t);
+        }
+    }
+
+    stat_.bytes -= e.bytes;
+    --stat_.entries;
+    entries_.erase(e.key);
+    lru_.erase(it);
+}
+
+DBM_INLINE std::string query_cache::prepared_key(kind::prepared_statement& stmt)
+{
+    std::string key = stmt.statement();
+    key.push_back('\0');
+    for (auto const* p : stmt.parms()) {
+        key += std::to_string(static_cast<int>(p->type()));
+        if (p->is_null()) {
+            key.push_back('N');
+        }
+        else {
+            key.push_back('=');
+            key += p->to_string();
+        }
+        key.push_back('\0');
+    }
+    return key;
+}
+
+DBM_INLINE size_t query_cache::entry_size(entry const& e)
+{
+    size_t n = sizeof(entry) + e.key.size();
+    for (auto const& t : e.tables) {
+        n += t.size();
+    }
+
+    if (auto const* dump = std::get_if<kind::sql_rows_dump>(&e.value)) {
+        n += dump->data_size() + (dump->num_values() + dump->size()) * sizeof(uint64_t);
+    }
+    else {
+        for (auto const& row : std::get<prepared_rows>(e.value)) {
+            for (auto const& c : row) {
+                n += 64 + (c->is_null() ? 0 : c->to_string().size());
+            }
+        }
+    }
+    return n;
+}
+
+namespace detail {
+
+DBM_INLINE std::string normalize_table_name(std::string_view table)
+{
+    // database prefix is ignored (invalidates more rather than less)
+    auto pos = table.rfind('.');
+    if (pos != std::string_view::npos)
+        table.remove_prefix(pos + 1);
+
+    std::string s;
+    s.reserve(table.size());
+    for (char c : table) {
+        if (c != '`' && c != '"' && c != '[' && c != ']')
+            s.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    return s;
+}
+
+DBM_INLINE statement_info parse_statement_info(std::string_view sql)
+{
+    statement_info info;
+
+    auto upper = [](std::string_view s) {
+        std::string r(s);
+        for (auto& c : r)
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        return r;
+    };
+
+    auto is_ident_char = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$' || c == '.'
+               || c == '`' || c == '"' || c == '[' || c == ']' || (static_cast<unsigned char>(c) & 0x80);
+    };
+
+    // split into tokens, strings and comments are skipped, ';' separates statements
+    std::vector<std::vector<std::string_view>> statements(1);
+    size_t i = 0;
+    while (i < sql.size()) {
+        char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        }
+        else if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            while (i < sql.size() && sql[i] != '\n')
+                ++i;
+        }
+        else if (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*') {
+            auto end = sql.find("*/", i + 2);
+            i = end == std::string_view::npos ? sql.size() : end + 2;
+        }
+        else if (c == '\'') {
+            ++i;
+            while (i < sql.size() && !(sql[i] == '\'' && (i + 1 >= sql.size() || sql[i + 1] != '\''))) {
+                i += (sql[i] == '\'' || sql[i] == '\\') ? 2 : 1;
+            }
+            ++i;
+            statements.back().emplace_back("''");
+        }
+        else if (c == ';') {
+            ++i;
+            if (!statements.back().empty())
+                statements.emplace_back();
+        }
+        else if (is_ident_char(c)) {
+            size_t start = i;
+            char quote = (c == '`' || c == '"') ? c : (c == '[' ? ']' : 0);
+            if (quote) {
+                auto end = sql.find(quote, i + 1);
+                i = end == std::string_view::npos ? sql.size() : end + 1;
+            }
+            while (i < sql.size() && is_ident_char(sql[i]) && sql[i] != '`' && sql[i] != '"' && sql[i] != '[') {
+                ++i;
+            }
+            // db.`table` - keep quoted continuation
+            while (i < sql.size() && (sql[i] == '`' || sql[i] == '"') && sql[i - 1] == '.') {
+                auto end = sql.find(sql[i], i + 1);
+                i = end == std::string_view::npos ? sql.size() : end + 1;
+            }
+            statements.back().push_back(sql.substr(start, i - start));
+        }
+        else {
+            statements.back().push_back(sql.substr(i, 1));
+            ++i;
+        }
+    }
+    if (statements.back().empty())
+        statements.pop_back();
+
+    // clauses ending a FROM list ('ON' and 'USING' do not - a comma may follow a join condition)
+    static const char* const from_end[] = {"WHERE", "GROUP", "ORDER", "HAVING", "LIMIT", "UNION", "WINDOW",
+                                           "OFFSET", "FOR", "EXCEPT", "INTERSECT", "RETURNING"};
+
+    auto is_from_end = [&](std::string const& kw) {
+        return std::find(std::begin(from_end), std::end(from_end), kw) != std::end(from_end);
+    };
+
+    auto is_name = [](std::string_view t) {
+        return !t.empty() && t != "''" && t != "(" && t != ")" && t != "," && t != "*";
+    };
+
+    // values and functions depending on time, randomness or session state (DATE and TIME functions too,
+    // as their 'now' argument is not checked)
+    static const char* const volatile_values[] = {"CURRENT_DATE", "CURRENT_TIME", "CURRENT_TIMESTAMP", "LOCALTIME",
+                                                  "LOCALTIMESTAMP", "CURRENT_USER", "@"};
+    static const char* const volatile_functions[] = {
+        "NOW", "SYSDATE", "CURDATE", "CURTIME", "UTC_DATE", "UTC_TIME", "UTC_TIMESTAMP", "UNIX_TIMESTAMP",
+        "UNIXEPOCH", "DATE", "TIME", "DATETIME", "JULIANDAY", "STRFTIME", "RAND", "RANDOM", "RANDOMBLOB", "UUID",
+        "UUID_SHORT", "LAST_INSERT_ID", "LAST_INSERT_ROWID", "CHANGES", "TOTAL_CHANGES", "ROW_COUNT", "FOUND_ROWS",
+        "CONNECTION_ID", "USER", "SESSION_USER", "SYSTEM_USER", "DATABASE", "SCHEMA", "GET_LOCK", "RELEASE_LOCK",
+        "IS_FREE_LOCK", "IS_USED_LOCK", "SLEEP", "BENCHMARK", "NEXTVAL", "LASTVAL", "VERSION", "SQLITE_VERSION"};
+
+    auto is_volatile = [&](std::string const& u, bool call) {
+        return std::find(std::begin(volatile_values), std::end(volatile_values), u) != std::end(volatile_values)
+               || (call && std::find(std::begin(volatile_functions), std::end(volatile_functions), u) != std::end(volatile_functions));
+    };
+
+    for (auto const& tokens : statements) {
+        // statement kind is the main verb, CTE definitions of a WITH statement are skipped
+        size_t v = 0;
+        if (upper(tokens.front()) == "WITH") {
+            int depth = 0;
+            for (size_t t = 1; t < tokens.size(); ++t) {
+                auto u = upper(tokens[t]);
+                depth += u == "(" ? 1 : (u == ")" ? -1 : 0);
+                if (depth == 0 && (u == "SELECT" || u == "VALUES" || u == "INSERT" || u == "REPLACE"
+                                   || u == "UPDATE" || u == "DELETE")) {
+                    v = t;
+                    break;
+                }
+            }
+        }
+        auto kw = upper(tokens[v]);
+        auto token_after = [&](size_t n) { return v + n < tokens.size() ? upper(tokens[v + n]) : std::string(); };
+
+        if (kw == "SELECT" || kw == "VALUES") {
+            info.cacheable = statements.size() == 1;
+
+            // FROM list state by parenthesis depth (subqueries)
+            std::vector<bool> in_from {false};
+            for (size_t t = 0; t < tokens.size(); ++t) {
+                auto u = upper(tokens[t]);
+                bool next_is_name = t + 1 < tokens.size() && is_name(tokens[t + 1]);
+
+                if (u == "FOR" || u == "INTO" || u == "LOCK" || is_volatile(u, t + 1 < tokens.size() && tokens[t + 1] == "(")) {
+                    // SELECT ... FOR UPDATE / LOCK IN SHARE MODE / INTO, session variables and functions
+                    info.cacheable = false;
+                }
+
+                if (u == "FROM" || u == "JOIN" || u == "STRAIGHT_JOIN") {
+                    in_from.back() = true;
+                    if (next_is_name)
+                        info.read_tables.emplace_back(tokens[t + 1]);
+                }
+                else if (u == "," && in_from.back() && next_is_name) {
+                    info.read_tables.emplace_back(tokens[t + 1]);
+                }
+                else if (u == "(") {
+                    in_from.push_back(false);
+                }
+                else if (u == ")") {
+                    if (in_from.size() > 1)
+                        in_from.pop_back();
+                }
+                else if (is_from_end(u)) {
+                    in_from.back() = false;
+                }
+            }
+
+            // results of statements reading no tables are never invalidated
+            if (info.read_tables.empty())
+                info.cacheable = false;
+        }
+        else if (kw == "BEGIN" || (kw == "START" && token_after(1) == "TRANSACTION")) {
+            info.begin_transaction = true;
+        }
+        else if (kw == "COMMIT" || kw == "END" || (kw == "ROLLBACK" && token_after(1) != "TO")) {
+            info.end_transaction = true;
+        }
+        else if (kw == "INSERT" || kw == "REPLACE" || kw == "UPDATE" || kw == "DELETE"
+                 || kw == "TRUNCATE" || kw == "DROP" || kw == "ALTER" || kw == "CREATE") {
+            // first name after the target keyword and modifiers
+            static const char* const skip[] = {"INTO", "FROM", "TABLE", "OR", "REPLACE", "ROLLBACK", "ABORT", "FAIL",
+                                               "IGNORE", "LOW_PRIORITY", "DELAYED", "HIGH_PRIORITY", "QUICK", "IF",
+                                               "NOT", "EXISTS", "TEMPORARY", "TEMP", "ONLY"};
+            size_t target = tokens.size();
+            for (size_t t = v + 1; t < tokens.size(); ++t) {
+                auto u = upper(tokens[t]);
+                if (std::find(std::begin(skip), std::end(skip), u) == std::end(skip)) {
+                    if (is_name(tokens[t]))
+                        target = t;
+                    break;
+                }
+            }
+
+            bool table_ddl = kw == "INSERT" || kw == "REPLACE" || kw == "UPDATE" || kw == "DELETE"
+                             || token_after(1) == "TABLE" || (kw == "TRUNCATE" && !token_after(1).empty());
+            if (target < tokens.size() && table_ddl) {
+                info.write_tables.emplace_back(tokens[target]);
+
+                // multi table UPDATE / DELETE and DROP / TRUNCATE lists - every listed or joined table
+                // (DELETE aliases and joined tables which are only read invalidate more rather than less)
+                if (kw == "UPDATE" || kw == "DELETE" || kw == "DROP" || kw == "TRUNCATE") {
+                    int depth = 0;
+                    for (size_t t = target + 1; t + 1 < tokens.size(); ++t) {
+                        auto u = upper(tokens[t]);
+                        depth += u == "(" ? 1 : (u == ")" ? -1 : 0);
+                        if (depth != 0)
+                            continue;
+                        if (u == "SET" || is_from_end(u))
+                            break;
+                        if ((u == "," || u == "FROM" || u == "JOIN" || u == "STRAIGHT_JOIN" || u == "USING")
+                            && is_name(tokens[t + 1])
+                            && std::find(info.write_tables.begin(), info.write_tables.end(), tokens[t + 1]) == info.write_tables.end()) {
+                            info.write_tables.emplace_back(tokens[t + 1]);
+                        }
+                    }
+                }
+            }
+            else if (!(kw == "CREATE" || kw == "DROP" || kw == "ALTER") || token_after(1) == "DATABASE"
+                     || token_after(1) == "SCHEMA" || token_after(1) == "VIEW") {
+                info.invalidate_all = true;
+            }
+            // CREATE INDEX / TRIGGER ... do not change data
+        }
+        else if (kw == "SHOW" || kw == "EXPLAIN" || kw == "DESCRIBE" || kw == "DESC" || kw == "SET"
+                 || kw == "PRAGMA" || kw == "SAVEPOINT" || kw == "RELEASE" || kw == "ROLLBACK" || kw == "ANALYZE") {
+            // no data changes (PRAGMA and SET results are never cached)
+        }
+        else {
+            // CALL, USE, LOAD DATA, MERGE, WITH of an unknown statement ...
+            info.invalidate_all = true;
+        }
+    }
+
+    return info;
+}
+
+} // namespace detail
+
+} // namespace dbm
+
+#endif //DBM_QUERY_CACHE_HPP
@@ -4,12 +4,18 @@
 #include <dbm/dbm_common.hpp>
 #include <dbm/sql_types.hpp>
 #include <dbm/prepared_statement.hpp>
+#include <dbm/query_cache.hpp>
+#include <dbm/latency_histogram.hpp>
 
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace dbm {
 
 class model;
+class identity_cache;
 
 struct DBM_EXPORT session_base_tag
 {
@@ -37,16 +43,47 @@ public:
     void close() { self().close_impl(); }
     bool is_connected() const { return self().is_connected_impl(); }
 
-    void query(std::string_view statement) { self().query_impl(statement); }
-    void query(const detail::statement& q) { self().query_impl(q.get()); }
-    kind::sql_rows select(std::string_view statement) { return self().select_rows(statement); }
+    /*!
+     * Checks whether the connection is alive without running a query (closes a lost connection)
+     */
+    bool ping() { return self().ping_impl(); }
+
+    void query(std::string_view statement);
+    void query(const detail::statement& q) { query(q.get()); }
+    kind::sql_rows select(std::string_view statement);
     kind::sql_rows select(const std::vector<std::string>& what, std::string_view table, std::string_view criteria="");
     kind::sql_rows select(const detail::statement& q) { return select(q.get()); }
 
-    void init_prepared_statement(dbm::kind::prepared_statement& stmt) { self().init_prepared_statement_impl(stmt); }
+    /*!
+     * Sets statement native handle, the statement is prepared if it is not yet prepared by this session
+     *
+     * Handles of statements with a slot are resolved by slot index instead of a lookup by statement.
+     */
+    void init_prepared_statement(dbm::kind::prepared_statement& stmt);
     void remove_prepared_statement(std::string const& s);
-    void query(kind::prepared_statement& stmt) { self().query_impl(stmt); }
-    std::vector<std::vector<container_ptr>> select(kind::prepared_statement& stmt) { return self().select_impl(stmt); }
+    void query(kind::prepared_statement& stmt);
+    std::vector<std::vector<container_ptr>> select(kind::prepared_statement& stmt);
+
+    /*!
+     * Sets result cache used by select (nullptr disables caching)
+     *
+     * Selects inside a transaction bypass the cache. Tables written by this session
+     * are invalidated (again at the end of a transaction).
+     */
+    void set_query_cache(std::shared_ptr<query_cache> cache) { query_cache_ = std::move(cache); }
+    std::shared_ptr<query_cache> const& get_query_cache() const noexcept { return query_cache_; }
+
+    /*!
+     * Sets primary key identity cache used by model reads and writes (nullptr disables caching)
+     */
+    void set_identity_cache(std::shared_ptr<identity_cache> cache) { identity_cache_ = std::move(cache); }
+    std::shared_ptr<identity_cache> const& get_identity_cache() const noexcept { return identity_cache_; }
+
+    /*!
+     * Sets histogram recording database round trip time of queries and selects (nullptr disables recording)
+     */
+    void set_query_histogram(std::shared_ptr<latency_histogram> h) { query_histogram_ = std::move(h); }
+    std::shared_ptr<latency_histogram> const& get_query_histogram() const noexcept { return query_histogram_; }
 
     std::string write_model_query(const model& m) const { return self().write_model_query_impl(m); }
     std::string read_model_query(const model& m, const std::string& extra_condition="") const { return self().read_model_query_impl(m, extra_condition); }
@@ -77,6 +114,21 @@ protected:
 
     std::string last_statement_;
     std::unordered_map<std::string, void*> prepared_stm_handle_;
+    std::vector<std::pair<std::string const*, void*>> prepared_stm_slots_; // statement and handle by slot (owned by prepared_stm_handle_)
+
+private:
+    friend class model;
+
+    // model writes update the identity cache record instead of invalidating the table
+    void query(std::string_view statement, bool invalidate_identity);
+    void on_query_executed(detail::statement_info const& info, bool succeeded, bool invalidate_identity);
+
+    std::shared_ptr<query_cache> query_cache_;
+    std::shared_ptr<identity_cache> identity_cache_;
+    std::shared_ptr<latency_histogram> query_histogram_;
+    bool in_transaction_ {false};                          // tracked only if a cache is set
+    bool transaction_writes_all_ {false};                  // unknown write in the current transaction
+    std::unordered_set<std::string> transaction_writes_;   // tables written in the current transaction
 };
 
 /*!
@@ -0,0 +1,34 @@
+#ifndef DBM_SQL_RESULT_HPP
+#define DBM_SQL_RESULT_HPP
+
+namespace dbm::kind {
+
+/**
+ * Single statement result of a multi statement query
+ */
+struct sql_result
+{
+    /**
+     * Result set rows (empty field names if the statement didn't produce a result set)
+     */
+    sql_rows rows;
+
+    /**
+     * Number of affected rows (number of rows for result sets)
+     */
+    uint64_t affected_rows {0};
+
+    bool has_result_set() const noexcept
+    {
+        return !rows.field_names().empty();
+    }
+};
+
+/**
+ * Multi statement query results
+ */
+typedef std::vector<sql_result> sql_results;
+
+}
+
+#endif //DBM_SQL_RESULT_HPP
@@ -1,64 +1,193 @@
 #ifndef DBM_SQL_ROW_HPP
 #define DBM_SQL_ROW_HPP
 
+#include <atomic>
+#include <mutex>
+
 namespace dbm::kind {
 
+class sql_row;
+
+/**
+ * Sql rows data
+ *
+ * Values of all rows are stored in a single row-major array. Rows are lightweight views
+ * (first value index and number of values) into this array.
+ */
+struct sql_rows_data
+{
+    sql_fields fnames;
+    sql_field_map fmap;
+    std::vector<sql_value> values;
+    std::vector<sql_row> rows;
+    std::shared_ptr<void> storage; // native result buffer values are pointing to (shared by copies)
+
+    sql_rows_data() = default;
+
+    sql_rows_data(sql_rows_data const& oth)
+        : fnames(oth.fnames)
+        , fmap(oth.fmap)
+        , values(oth.values)
+        , rows(oth.rows)
+        , storage(oth.storage)
+    {}
+
+    sql_rows_data& operator=(sql_rows_data const&) = delete;
+
+    int column_index(column_id id) const
+    {
+        auto const& index = ids().second;
+        auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(id, 0));
+        if (it != index.end() && it->first == id)
+            return it->second;
+
+        // name interned after the table was built
+        if (id.valid() && id.value() >= ids_interned_) {
+            auto f = fmap.find(id.name());
+            return f != fmap.end() ? f->second : -1;
+        }
+        return -1;
+    }
+
+    /**
+     * Field name ids (by column index) and id to column index table (sorted)
+     *
+     * Built on the first lookup by id (thread safe, rows may be shared read-only), so
+     * queries which are never accessed by id do not touch the column id registry.
+     */
+    std::pair<std::vector<column_id>, std::vector<std::pair<column_id, int>>> const& ids() const
+    {
+        if (!ids_ready_.load(std::memory_order_acquire)) {
+            std::lock_guard lock(ids_mtx_);
+            if (!ids_ready_.load(std::memory_order_relaxed)) {
+                ids_.first = column_id::find(fnames, ids_interned_);
+                ids_.second.clear();
+                // same column as the field map for duplicate names
+                for (auto const& it : fmap) {
+                    if (auto id = ids_.first[static_cast<size_t>(it.second)]; id.valid())
+                        ids_.second.emplace_back(id, it.second);
+                }
+                std::sort(ids_.second.begin(), ids_.second.end());
+                ids_ready_.store(true, std::memory_order_release);
+            }
+        }
+        return ids_;
+    }
+
+    /**
+     * Must be called when field names change
+     */
+    void reset_ids() noexcept
+    {
+        ids_ready_.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    mutable std::pair<std::vector<column_id>, std::vector<std::pair<column_id, int>>> ids_;
+    mutable uint32_t ids_interned_ {0};
+    mutable std::atomic<bool> ids_ready_ {false};
+    mutable std::mutex ids_mtx_;
+};
+
 /**
  * Sql row
+ *
+ * View of a single row values in the parent sql_rows. Values can only be appended to the last row.
  */
-class sql_row : private std::vector<sql_value>
+class sql_row
 {
+    friend class sql_rows;
 public:
-    typedef std::vector<sql_value> vector_type;
+    typedef sql_value value_type;
+    typedef sql_value* iterator;
+    typedef sql_value const* const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 
     sql_row() = default;
 
     ~sql_row() = default;
 
-    // vector_type member types
-    using vector_type::iterator;
-    using vector_type::const_iterator;
-    using vector_type::reverse_iterator;
-    using vector_type::const_reverse_iterator;
-    // vector_type member functions
-    using vector_type::assign;
-    // vector_type element access
-    using vector_type::at;
-    using vector_type::operator[];
-    using vector_type::front;
-    using vector_type::back;
-    using vector_type::data;
-    // vector_type iterators
-    using vector_type::begin;
-    using vector_type::end;
-    using vector_type::cbegin;
-    using vector_type::cend;
-    using vector_type::crbegin;
-    using vector_type::crend;
-    // vector_type capacity
-    using vector_type::empty;
-    using vector_type::size;
-    using vector_type::max_size;
-    using vector_type::reserve;
-    using vector_type::capacity;
-    using vector_type::shrink_to_fit;
-    // vector_type modifiers
-    using vector_type::clear;
-    using vector_type::insert;
-    using vector_type::emplace;
-    using vector_type::erase;
-    using vector_type::push_back;
-    using vector_type::emplace_back;
-    using vector_type::pop_back;
-    using vector_type::resize;
-    // no swap
-
-    void set_fields(kind::sql_fields* field_names, sql_field_map* field_map) noexcept;
+    // element access
+    sql_value& at(size_t pos);
+
+    sql_value const& at(size_t pos) const;
 
     sql_value& at(std::string const& key);
 
     sql_value const& at(std::string const& key) const;
 
+    sql_value& at(column_id id);
+
+    sql_value const& at(column_id id) const;
+
+    sql_value& at(sql_column col) { return at(col.index()); }
+
+    sql_value const& at(sql_column col) const { return at(col.index()); }
+
+    sql_value& operator[](size_t pos) noexcept { return data()[pos]; }
+
+    sql_value const& operator[](size_t pos) const noexcept { return data()[pos]; }
+
+    sql_value& operator[](sql_column col) noexcept { return data()[col.index()]; }
+
+    sql_value const& operator[](sql_column col) const noexcept { return data()[col.index()]; }
+
+    /**
+     * Column index of an interned field name (-1 if not found)
+     */
+    int column_index(column_id id) const { return d_ ? d_->column_index(id) : -1; }
+
+    sql_value& front() noexcept { return *data(); }
+
+    sql_value const& front() const noexcept { return *data(); }
+
+    sql_value& back() noexcept { return data()[size_ - 1]; }
+
+    sql_value const& back() const noexcept { return data()[size_ - 1]; }
+
+    sql_value* data() noexcept { return d_ ? d_->values.data() + begin_ : nullptr; }
+
+    sql_value const* data() const noexcept { return d_ ? d_->values.data() + begin_ : nullptr; }
+
+    // iterators
+    iterator begin() noexcept { return data(); }
+
+    iterator end() noexcept { return data() + size_; }
+
+    const_iterator begin() const noexcept { return data(); }
+
+    const_iterator end() const noexcept { return data() + size_; }
+
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    const_iterator cend() const noexcept { return end(); }
+
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+
+    const_reverse_iterator crend() const noexcept { return rend(); }
+
+    // capacity
+    bool empty() const noexcept { return size_ == 0; }
+
+    size_t size() const noexcept { return size_; }
+
+    void reserve(size_t n);
+
+    // modifiers (last row only)
+    template<typename... Args>
+    sql_value& emplace_back(Args&&... args);
+
+    void push_back(sql_value const& v) { emplace_back(v); }
+
     sql_fields* field_names() noexcept;
 
     sql_fields const* field_names() const noexcept;
@@ -68,52 +197,115 @@ public:
     sql_field_map const* field_map() const noexcept;
 
 private:
-    sql_fields* fnames_ { nullptr };
-    sql_field_map* fmap_ { nullptr };
+    sql_row(sql_rows_data* d, size_t begin) noexcept
+        : d_(d)
+        , begin_(begin)
+    {}
+
+    void check_last_row() const;
+
+    sql_rows_data* d_ {nullptr};
+    size_t begin_ {0};
+    size_t size_ {0};
 };
 
-DBM_INLINE void sql_row::set_fields(kind::sql_fields* field_names, sql_field_map* field_map) noexcept
+DBM_INLINE sql_value& sql_row::at(size_t pos)
+{
+    if (pos >= size_)
+        throw_exception<std::out_of_range>("sql row index out of range " + std::to_string(pos));
+    return data()[pos];
+}
+
+DBM_INLINE sql_value const& sql_row::at(size_t pos) const
 {
-    fnames_ = field_names;
-    fmap_ = field_map;
+    if (pos >= size_)
+        throw_exception<std::out_of_range>("sql row index out of range " + std::to_string(pos));
+    return data()[pos];
 }
 
 DBM_INLINE sql_value& sql_row::at(std::string const& key)
 {
-    auto it = fmap_->find(key);
-    if (it != fmap_->end()) {
-        return at(it->second);
+    if (d_) {
+        auto it = d_->fmap.find(key);
+        if (it != d_->fmap.end()) {
+            return at(it->second);
+        }
     }
     throw_exception<std::out_of_range>("sql row item not found " + std::string(key));
 }
 
 DBM_INLINE sql_value const& sql_row::at(std::string const& key) const
 {
-    auto it = fmap_->find(key);
-    if (it != fmap_->end()) {
-        return at(it->second);
+    if (d_) {
+        auto it = d_->fmap.find(key);
+        if (it != d_->fmap.end()) {
+            return at(it->second);
+        }
     }
     throw_exception<std::out_of_range>("sql row item not found " + std::string(key));
 }
 
+DBM_INLINE sql_value& sql_row::at(column_id id)
+{
+    int idx = column_index(id);
+    if (idx < 0)
+        throw_exception<std::out_of_range>("sql row item not found " + (id.valid() ? id.name() : std::string()));
+    return at(static_cast<size_t>(idx));
+}
+
+DBM_INLINE sql_value const& sql_row::at(column_id id) const
+{
+    int idx = column_index(id);
+    if (idx < 0)
+        throw_exception<std::out_of_range>("sql row item not found " + (id.valid() ? id.name() : std::string()));
+    return at(static_cast<size_t>(idx));
+}
+
+DBM_INLINE void sql_row::reserve(size_t n)
+{
+    check_last_row();
+
+    // geometric growth - rows are reserved one after another
+    auto& values = d_->values;
+    if (begin_ + n > values.capacity()) {
+        values.reserve(std::max(begin_ + n, values.capacity() * 2));
+    }
+}
+
+template<typename... Args>
+DBM_INLINE sql_value& sql_row::emplace_back(Args&&... args)
+{
+    check_last_row();
+    auto& v = d_->values.emplace_back(std::forward<Args>(args)...);
+    ++size_;
+    return v;
+}
+
 DBM_INLINE sql_fields* sql_row::field_names() noexcept
 {
-    return fnames_;
+    return d_ ? &d_->fnames : nullptr;
 }
 
 DBM_INLINE sql_fields const* sql_row::field_names() const noexcept
 {
-    return fnames_;
+    return d_ ? &d_->fnames : nullptr;
 }
 
 DBM_INLINE sql_field_map* sql_row::field_map() noexcept
 {
-    return fmap_;
+    return d_ ? &d_->fmap : nullptr;
 }
 
 DBM_INLINE sql_field_map const* sql_row::field_map() const noexcept
 {
-    return fmap_;
+    return d_ ? &d_->fmap : nullptr;
+}
+
+DBM_INLINE void sql_row::check_last_row() const
+{
+    if (!d_ || &d_->rows.back() != this) {
+        throw_exception<std::domain_error>("sql row values can only be appended to the last row of sql rows");
+    }
 }
 
 }
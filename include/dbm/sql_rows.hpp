@@ -1,157 +1,398 @@
 #ifndef DBM_SQL_ROWS_HPP
 #define DBM_SQL_ROWS_HPP
 
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+
 namespace dbm::kind {
 
+/**
+ * Column values extracted from sql rows (see sql_rows::column_as)
+ */
+template<typename T>
+struct sql_column_values
+{
+    std::vector<T> values;      // T{} for null values
+    std::vector<uint8_t> nulls; // 1 if value is null
+    size_t null_count {0};
+};
+
+namespace detail {
+
+/**
+ * Parses a whole value as number (leading whitespace and '+' sign are accepted as with stream extraction)
+ */
+template<typename T>
+DBM_INLINE bool parse_number(const char* first, const char* last, T& val) noexcept
+{
+    while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+        ++first;
+    }
+    if (first != last && *first == '+') {
+        ++first;
+    }
+
+    if constexpr (std::is_integral_v<T>) {
+        auto res = std::from_chars(first, last, val);
+        return res.ec == std::errc() && res.ptr == last;
+    }
+    else {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        auto res = std::from_chars(first, last, val);
+        return res.ec == std::errc() && res.ptr == last;
+#else
+        // values are NUL terminated
+        char* end;
+        errno = 0;
+        val = static_cast<T>(std::strtold(first, &end));
+        return end == last && first != last && errno == 0;
+#endif
+    }
+}
+
+} // namespace detail
+
 /**
  * Sql rows
+ *
+ * Values are stored in a single flat row-major array owned by a heap allocated block
+ * (see sql_rows_data), so moves are O(1) and rows are contiguous in memory.
  */
-class sql_rows : private std::vector<sql_row>
+class sql_rows
 {
-    friend class sql_rows_dump;
 public:
-    typedef std::vector<sql_row> vector_type;
+    typedef sql_row value_type;
+    typedef sql_row* iterator;
+    typedef sql_row const* const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 
     sql_rows() = default;
 
     sql_rows(const sql_rows& oth);
 
-    sql_rows(sql_rows&& oth) noexcept;
+    sql_rows(sql_rows&& oth) noexcept = default;
 
     ~sql_rows() = default;
 
-    // vector_type member types
-    using vector_type::iterator;
-    using vector_type::const_iterator;
-    using vector_type::reverse_iterator;
-    using vector_type::const_reverse_iterator;
-    // vector_type member functions
-    using vector_type::assign;
-    // vector_type element access
-    using vector_type::at;
-    using vector_type::operator[];
-    using vector_type::front;
-    using vector_type::back;
-    using vector_type::data;
-    // vector_type iterators
-    using vector_type::begin;
-    using vector_type::end;
-    using vector_type::cbegin;
-    using vector_type::cend;
-    using vector_type::crbegin;
-    using vector_type::crend;
-    // vector_type capacity
-    using vector_type::empty;
-    using vector_type::size;
-    using vector_type::max_size;
-    using vector_type::reserve;
-    using vector_type::capacity;
-    using vector_type::shrink_to_fit;
-    // vector_type modifiers
-    using vector_type::clear;
-    using vector_type::insert;
-    using vector_type::emplace;
-    using vector_type::erase;
-    using vector_type::push_back;
-    using vector_type::emplace_back;
-    using vector_type::pop_back;
-    using vector_type::resize;
-    // no swap
-
     sql_rows& operator=(const sql_rows& oth);
 
-    sql_rows& operator=(sql_rows&& oth) noexcept;
+    sql_rows& operator=(sql_rows&& oth) noexcept = default;
+
+    // element access
+    sql_row& at(size_t pos);
+
+    sql_row const& at(size_t pos) const;
+
+    sql_row& operator[](size_t pos) noexcept { return data()[pos]; }
+
+    sql_row const& operator[](size_t pos) const noexcept { return data()[pos]; }
+
+    sql_row& front() noexcept { return *data(); }
+
+    sql_row const& front() const noexcept { return *data(); }
+
+    sql_row& back() noexcept { return data()[size() - 1]; }
+
+    sql_row const& back() const noexcept { return data()[size() - 1]; }
+
+    sql_row* data() noexcept { return d_ ? d_->rows.data() : nullptr; }
+
+    sql_row const* data() const noexcept { return d_ ? d_->rows.data() : nullptr; }
+
+    // iterators
+    iterator begin() noexcept { return data(); }
+
+    iterator end() noexcept { return data() + size(); }
+
+    const_iterator begin() const noexcept { return data(); }
+
+    const_iterator end() const noexcept { return data() + size(); }
+
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    const_iterator cend() const noexcept { return end(); }
+
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+
+    const_reverse_iterator crend() const noexcept { return rend(); }
+
+    // capacity
+    bool empty() const noexcept { return size() == 0; }
+
+    size_t size() const noexcept { return d_ ? d_->rows.size() : 0; }
+
+    /**
+     * Reserves space for rows and (optionally) their values
+     */
+    void reserve(size_t n_rows, size_t n_values_per_row = 0);
+
+    // modifiers
+    void clear();
+
+    /**
+     * Appends an empty row (values are appended with sql_row::emplace_back)
+     */
+    sql_row& emplace_back();
+
+    void pop_back();
 
     void set_field_names(sql_fields&& f);
 
-    sql_fields& field_names() noexcept;
+    sql_fields& field_names();
 
     sql_fields const& field_names() const noexcept;
 
-    sql_field_map& field_map() noexcept;
+    sql_field_map& field_map();
 
     sql_field_map const& field_map() const noexcept;
 
+    /**
+     * Ids of field names by column index (invalid for names never interned)
+     */
+    std::vector<column_id> const& field_ids() const;
+
+    /**
+     * Column handle for repeated access by name without hashing
+     *
+     * auto price = rows.column("price");
+     * for (auto const& row : rows) { row[price].get<double>(); }
+     */
+    sql_column column(std::string const& name) const;
+
+    sql_column column(column_id id) const;
+
+    /**
+     * Column index of an interned field name (-1 if not found)
+     */
+    int column_index(column_id id) const { return d_ ? d_->column_index(id) : -1; }
+
+    /**
+     * Extracts all values of a column into a contiguous vector and a null mask
+     *
+     * Integral and floating point types are parsed in bulk with std::from_chars,
+     * other types are converted per value as sql_value::get<T>().
+     * Throws std::domain_error if a value cannot be converted.
+     */
+    template<typename T>
+    sql_column_values<T> column_as(size_t idx) const;
+
+    template<typename T>
+    sql_column_values<T> column_as(sql_column col) const { return column_as<T>(col.index()); }
+
+    template<typename T>
+    sql_column_values<T> column_as(std::string const& name) const { return column_as<T>(column(name)); }
+
+    /**
+     * Total number of values in all rows
+     */
+    size_t num_values() const noexcept { return d_ ? d_->values.size() : 0; }
+
+    void set_storage(std::shared_ptr<void> storage);
+
+    std::shared_ptr<void> const& storage() const noexcept;
+
 private:
-    void setup_rows();
+    sql_rows_data& mut();
 
-    sql_fields fnames_;
-    sql_field_map fmap_;
+    std::unique_ptr<sql_rows_data> d_;
 };
 
 DBM_INLINE sql_rows::sql_rows(const sql_rows& oth)
-    : std::vector<sql_row>(oth)
-    , fnames_(oth.fnames_)
-    , fmap_(oth.fmap_)
 {
-    setup_rows();
-}
-
-DBM_INLINE sql_rows::sql_rows(sql_rows&& oth) noexcept
-    : std::vector<sql_row>(std::move(oth))
-    , fnames_(std::move(oth.fnames_))
-    , fmap_(std::move(oth.fmap_))
-{
-    setup_rows();
+    *this = oth;
 }
 
 DBM_INLINE sql_rows& sql_rows::operator=(const sql_rows& oth)
 {
     if (this != &oth) {
-        std::vector<sql_row>::operator=(oth);
-        fnames_ = oth.fnames_;
-        fmap_ = oth.fmap_;
-        setup_rows();
+        if (oth.d_) {
+            d_ = std::make_unique<sql_rows_data>(*oth.d_);
+            for (auto& row : d_->rows) {
+                row.d_ = d_.get();
+            }
+        }
+        else {
+            d_.reset();
+        }
     }
     return *this;
 }
 
-DBM_INLINE sql_rows& sql_rows::operator=(sql_rows&& oth) noexcept
+DBM_INLINE sql_row& sql_rows::at(size_t pos)
 {
-    if (this != &oth) {
-        std::vector<sql_row>::operator=(std::move(oth));
-        fnames_ = std::move(oth.fnames_);
-        fmap_ = std::move(oth.fmap_);
-        setup_rows();
+    if (pos >= size())
+        throw_exception<std::out_of_range>("sql rows index out of range " + std::to_string(pos));
+    return data()[pos];
+}
+
+DBM_INLINE sql_row const& sql_rows::at(size_t pos) const
+{
+    if (pos >= size())
+        throw_exception<std::out_of_range>("sql rows index out of range " + std::to_string(pos));
+    return data()[pos];
+}
+
+DBM_INLINE void sql_rows::reserve(size_t n_rows, size_t n_values_per_row)
+{
+    auto& d = mut();
+    d.rows.reserve(n_rows);
+    d.values.reserve(n_rows * n_values_per_row);
+}
+
+DBM_INLINE void sql_rows::clear()
+{
+    if (d_) {
+        d_->rows.clear();
+        d_->values.clear();
+        d_->storage.reset();
+    }
+}
+
+DBM_INLINE sql_row& sql_rows::emplace_back()
+{
+    auto& d = mut();
+    return d.rows.emplace_back(sql_row(&d, d.values.size()));
+}
+
+DBM_INLINE void sql_rows::pop_back()
+{
+    if (d_ && !d_->rows.empty()) {
+        d_->values.resize(d_->rows.back().begin_);
+        d_->rows.pop_back();
     }
-    return *this;
 }
 
 DBM_INLINE void sql_rows::set_field_names(sql_fields&& f)
 {
-    fmap_.clear();
-    fnames_ = std::move(f);
+    auto& d = mut();
+    d.fmap.clear();
+    d.fnames = std::move(f);
+    d.reset_ids();
 
-    for (int i = 0; i < static_cast<int>(fnames_.size()); i++) {
-        fmap_[fnames_[i]] = i;
+    for (int i = 0; i < static_cast<int>(d.fnames.size()); i++) {
+        d.fmap[d.fnames[i]] = i;
     }
 }
 
-DBM_INLINE sql_fields& sql_rows::field_names() noexcept
+DBM_INLINE sql_fields& sql_rows::field_names()
 {
-    return fnames_;
+    auto& d = mut();
+    d.reset_ids();
+    return d.fnames;
 }
 
 DBM_INLINE sql_fields const& sql_rows::field_names() const noexcept
 {
-    return fnames_;
+    static sql_fields const empty;
+    return d_ ? d_->fnames : empty;
 }
 
-DBM_INLINE sql_field_map& sql_rows::field_map() noexcept
+DBM_INLINE sql_field_map& sql_rows::field_map()
 {
-    return fmap_;
+    auto& d = mut();
+    d.reset_ids();
+    return d.fmap;
 }
 
 DBM_INLINE sql_field_map const& sql_rows::field_map() const noexcept
 {
-    return fmap_;
+    static sql_field_map const empty;
+    return d_ ? d_->fmap : empty;
+}
+
+DBM_INLINE std::vector<column_id> const& sql_rows::field_ids() const
+{
+    static std::vector<column_id> const empty;
+    return d_ ? d_->ids().first : empty;
+}
+
+DBM_INLINE sql_column sql_rows::column(std::string const& name) const
+{
+    auto const& fmap = field_map();
+    auto it = fmap.find(name);
+    if (it == fmap.end())
+        throw_exception<std::out_of_range>("sql rows column not found " + name);
+    return sql_column(static_cast<size_t>(it->second), column_id(name));
+}
+
+DBM_INLINE sql_column sql_rows::column(column_id id) const
+{
+    int idx = column_index(id);
+    if (idx < 0)
+        throw_exception<std::out_of_range>("sql rows column not found " + (id.valid() ? id.name() : std::string()));
+    return sql_column(static_cast<size_t>(idx), id);
+}
+
+template<typename T>
+DBM_INLINE sql_column_values<T> sql_rows::column_as(size_t idx) const
+{
+    constexpr bool bulk = std::is_arithmetic_v<T>
+                          && !std::is_same_v<T, bool>
+                          && !std::is_same_v<T, char>
+                          && !std::is_same_v<T, signed char>
+                          && !std::is_same_v<T, unsigned char>;
+
+    sql_column_values<T> res;
+    size_t const n = size();
+    res.values.resize(n);
+    res.nulls.resize(n, 0);
+
+    sql_row const* rows = data();
+
+    for (size_t i = 0; i < n; ++i) {
+        if (idx >= rows[i].size()) {
+            throw_exception<std::out_of_range>("sql rows column index out of range " + std::to_string(idx));
+        }
+
+        sql_value const& v = rows[i][idx];
+        if (v.null()) {
+            res.nulls[i] = 1;
+            ++res.null_count;
+            continue;
+        }
+
+        if constexpr (bulk) {
+            auto s = v.get();
+            if (!detail::parse_number(s.data(), s.data() + s.size(), res.values[i])) {
+                throw_exception<std::domain_error>("sql_value conversion error (row " + std::to_string(i) + ")");
+            }
+        }
+        else {
+            res.values[i] = v.get<T>();
+        }
+    }
+
+    return res;
+}
+
+DBM_INLINE void sql_rows::set_storage(std::shared_ptr<void> storage)
+{
+    mut().storage = std::move(storage);
+}
+
+DBM_INLINE std::shared_ptr<void> const& sql_rows::storage() const noexcept
+{
+    static std::shared_ptr<void> const empty;
+    return d_ ? d_->storage : empty;
 }
 
-DBM_INLINE void sql_rows::setup_rows()
+DBM_INLINE sql_rows_data& sql_rows::mut()
 {
-    for (auto& it : *this) {
-        it.set_fields(&fnames_, &fmap_);
+    if (!d_) {
+        d_ = std::make_unique<sql_rows_data>();
     }
+    return *d_;
 }
 
 }
@@ -1,14 +1,31 @@
 #ifndef DBM_SQL_ROWS_DUMP_HPP
 #define DBM_SQL_ROWS_DUMP_HPP
 
+#include <dbm/detail/mapped_file.hpp>
+#include <cstring>
+#include <fstream>
+
 namespace dbm::kind {
 
 /**
  * Sql rows dump
+ *
+ * Values are stored in a single contiguous byte arena (each value NUL terminated) with
+ * per-cell offsets, per-row cell indexes and a null bitmap. Restored rows point straight
+ * into the arena and share its ownership, so they stay valid when the dump is destroyed.
+ * The arena is copy-on-write: appending to a dump with restored rows (or copies) alive
+ * first detaches it.
+ *
+ * The arena can be saved to a file and memory mapped back (read-only) - see save() and load_mmap().
  */
 class sql_rows_dump
 {
 public:
+    /**
+     * File format version written by save()
+     */
+    static constexpr uint32_t file_version = 1;
+
     sql_rows_dump() = default;
 
     ~sql_rows_dump() = default;
@@ -25,6 +42,25 @@ public:
 
     sql_rows restore();
 
+    /**
+     * Saves dump to a binary file
+     *
+     * The file is written next to the destination and renamed over it, so processes which
+     * have the previous version mapped are not affected.
+     */
+    void save(std::string const& path) const;
+
+    /**
+     * Loads dump from a file written by save()
+     *
+     * The file is memory mapped read-only and values are not copied - restored rows point
+     * into the mapping (which is kept alive by them). Appending to the dump copies the data
+     * into memory first. Loading does not read the data section - the header, section sizes and
+     * value offset and row indexes are validated (std::runtime_error is thrown for a corrupt file),
+     * value contents (including NUL terminators except the last one) are not.
+     */
+    void load_mmap(std::string const& path);
+
     sql_fields const& field_names() const noexcept;
 
     sql_field_map const& field_map() const noexcept;
@@ -35,12 +71,79 @@ public:
 
     void clear();
 
+    /**
+     * Total number of stored values (cells)
+     */
+    size_t num_values() const noexcept;
+
+    /**
+     * Arena size in bytes (values including NUL terminators)
+     */
+    size_t data_size() const noexcept;
+
+    /**
+     * True if data is memory mapped from a file
+     */
+    bool is_mapped() const noexcept;
+
 private:
+    struct file_header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t n_fields;
+        uint64_t n_rows;
+        uint64_t n_cells;
+        uint64_t data_size;
+        uint64_t names_size; // field names section size (multiple of 8)
+        uint64_t reserved;
+    };
+
+    static constexpr char file_magic[8] = {'D', 'B', 'M', 'R', 'O', 'W', 'S', '\0'};
+    static constexpr uint32_t file_byte_order = 0x01020304;
+
+    // read-only view of arena buffers (owned or mapped)
+    struct arena_view
+    {
+        char const* data;
+        uint64_t const* offsets; // value begin offset in data, one per cell + end offset
+        uint64_t const* rows;    // first cell index of each row + total number of cells
+        uint64_t const* nulls;   // null bitmap - one bit per cell
+        size_t n_rows;
+        size_t n_cells;
+        size_t data_size;
+
+        bool is_null(size_t cell) const noexcept { return (nulls[cell >> 6] >> (cell & 63)) & 1; }
+    };
+
+    struct arena
+    {
+        std::vector<char> data {};        // values, each NUL terminated
+        std::vector<uint64_t> offsets {0};
+        std::vector<uint64_t> rows {0};
+        std::vector<uint64_t> nulls {};
+
+        std::shared_ptr<utils::mapped_file> file {}; // set if buffers are mapped (vectors are unused)
+        arena_view mapped {};
+
+        arena_view view() const noexcept;
+    };
+
+    static size_t nulls_size(size_t n_cells) noexcept { return (n_cells + 63) / 64; }
+
+    template<typename Vec>
+    static void grow(Vec& v, size_t n);
+
+    arena& writable_arena();
+
     void append(const sql_rows& src);
 
+    void set_field_names(sql_fields&& fnames);
+
     sql_fields fnames_;
     sql_field_map fmap_;
-    std::vector<std::vector<std::optional<std::string>>> data_;
+    std::shared_ptr<arena> arena_;
 };
 
 DBM_INLINE sql_rows_dump::sql_rows_dump(const sql_rows& src) // implicit is desired
@@ -56,6 +159,10 @@ DBM_INLINE sql_rows_dump& sql_rows_dump::operator=(const sql_rows& src)
 
 DBM_INLINE sql_rows_dump& sql_rows_dump::operator+=(const sql_rows& src)
 {
+    if (empty() && fnames_.empty()) {
+        store(src);
+        return *this;
+    }
     if (src.field_map() != fmap_ && src.field_names() != fnames_) {
         throw_exception<std::domain_error>("Cannot append rows with different field names");
     }
@@ -65,11 +172,9 @@ DBM_INLINE sql_rows_dump& sql_rows_dump::operator+=(const sql_rows& src)
 
 DBM_INLINE void sql_rows_dump::store(const sql_rows& src)
 {
-    data_.clear();
+    arena_.reset();
     fnames_ = src.field_names();
     fmap_ = src.field_map();
-    //        size_t n = src.size() * field_names_.size();
-    //        data_.reserve(n);
     append(src);
 }
 
@@ -78,17 +183,24 @@ DBM_INLINE void sql_rows_dump::restore(sql_rows& dest)
     dest.clear();
     dest.set_field_names(sql_fields(fnames_));
 
-    for (const auto& row : data_) {
-        auto& dest_row = dest.emplace_back();
-        for (const auto& val : row) {
-            if (val)
-                dest_row.emplace_back(val->data(), val->size());
-            else
-                dest_row.emplace_back(nullptr, 0);
+    if (arena_) {
+        auto const a = arena_->view();
+        dest.reserve(a.n_rows, a.n_rows ? a.n_cells / a.n_rows : 0);
+
+        for (size_t ri = 0; ri < a.n_rows; ++ri) {
+            auto& dest_row = dest.emplace_back();
+            dest_row.reserve(a.rows[ri + 1] - a.rows[ri]);
+
+            for (size_t ci = a.rows[ri]; ci < a.rows[ri + 1]; ++ci) {
+                if (a.is_null(ci))
+                    dest_row.emplace_back(nullptr, 0);
+                else
+                    dest_row.emplace_back(a.data + a.offsets[ci], a.offsets[ci + 1] - a.offsets[ci] - 1);
+            }
         }
-    }
 
-    dest.setup_rows();
+        dest.set_storage(arena_);
+    }
 }
 
 DBM_INLINE sql_rows sql_rows_dump::restore()
@@ -98,6 +210,143 @@ DBM_INLINE sql_rows sql_rows_dump::restore()
     return rows;
 }
 
+DBM_INLINE void sql_rows_dump::save(std::string const& path) const
+{
+    arena const empty_arena;
+    auto const a = arena_ ? arena_->view() : empty_arena.view();
+
+    // field names section - length prefixed names padded to 8 bytes
+    std::vector<char> names;
+    for (auto const& name : fnames_) {
+        uint64_t len = name.size();
+        names.insert(names.end(), reinterpret_cast<char const*>(&len), reinterpret_cast<char const*>(&len) + sizeof(len));
+        names.insert(names.end(), name.begin(), name.end());
+    }
+    names.resize((names.size() + 7) / 8 * 8, '\0');
+
+    file_header hdr {};
+    std::memcpy(hdr.magic, file_magic, sizeof(file_magic));
+    hdr.version = file_version;
+    hdr.byte_order = file_byte_order;
+    hdr.n_fields = fnames_.size();
+    hdr.n_rows = a.n_rows;
+    hdr.n_cells = a.n_cells;
+    hdr.data_size = a.data_size;
+    hdr.names_size = names.size();
+
+    std::string const tmp_path = path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw_exception<std::runtime_error>("Cannot open file " + tmp_path);
+
+        f.write(reinterpret_cast<char const*>(&hdr), sizeof(hdr));
+        f.write(names.data(), static_cast<std::streamsize>(names.size()));
+        f.write(reinterpret_cast<char const*>(a.offsets), static_cast<std::streamsize>((a.n_cells + 1) * sizeof(uint64_t)));
+        f.write(reinterpret_cast<char const*>(a.rows), static_cast<std::streamsize>((a.n_rows + 1) * sizeof(uint64_t)));
+        f.write(reinterpret_cast<char const*>(a.nulls), static_cast<std::streamsize>(nulls_size(a.n_cells) * sizeof(uint64_t)));
+        f.write(a.data, static_cast<std::streamsize>(a.data_size));
+
+        if (!f.flush())
+            throw_exception<std::runtime_error>("Cannot write file " + tmp_path);
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw_exception<std::runtime_error>("Cannot rename file " + tmp_path + " to " + path);
+    }
+}
+
+DBM_INLINE void sql_rows_dump::load_mmap(std::string const& path)
+{
+    auto file = std::make_shared<utils::mapped_file>(path);
+    char const* p = file->data();
+    size_t const size = file->size();
+
+    auto invalid = [&path](std::string const& what) {
+        throw_exception<std::runtime_error>("Invalid rows dump file " + path + " : " + what);
+    };
+
+    if (size < sizeof(file_header))
+        invalid("file too short");
+
+    file_header hdr;
+    std::memcpy(&hdr, p, sizeof(hdr));
+
+    if (std::memcmp(hdr.magic, file_magic, sizeof(file_magic)) != 0)
+        invalid("bad magic");
+    if (hdr.byte_order != file_byte_order)
+        invalid("byte order mismatch");
+    if (hdr.version != file_version)
+        invalid("unsupported version " + std::to_string(hdr.version));
+    if (hdr.names_size % 8)
+        invalid("bad field names section size");
+    if (hdr.n_fields > size || hdr.n_cells > size || hdr.n_rows > size || hdr.data_size > size || hdr.names_size > size)
+        invalid("size mismatch");
+
+    size_t const expected = sizeof(file_header)
+                            + hdr.names_size
+                            + (hdr.n_cells + 1 + hdr.n_rows + 1 + nulls_size(hdr.n_cells)) * sizeof(uint64_t)
+                            + hdr.data_size;
+    if (size != expected)
+        invalid("size mismatch");
+
+    // field names
+    sql_fields fnames;
+    fnames.reserve(hdr.n_fields);
+    {
+        char const* it = p + sizeof(file_header);
+        char const* end = it + hdr.names_size;
+        for (uint64_t i = 0; i < hdr.n_fields; ++i) {
+            uint64_t len;
+            if (end - it < static_cast<ptrdiff_t>(sizeof(len)))
+                invalid("bad field names");
+            std::memcpy(&len, it, sizeof(len));
+            it += sizeof(len);
+            if (static_cast<uint64_t>(end - it) < len)
+                invalid("bad field names");
+            fnames.emplace_back(it, len);
+            it += len;
+        }
+    }
+
+    arena_view v {};
+    auto const* u64 = reinterpret_cast<uint64_t const*>(p + sizeof(file_header) + hdr.names_size);
+    v.offsets = u64;
+    v.rows = v.offsets + hdr.n_cells + 1;
+    v.nulls = v.rows + hdr.n_rows + 1;
+    v.data = reinterpret_cast<char const*>(v.nulls + nulls_size(hdr.n_cells));
+    v.n_rows = hdr.n_rows;
+    v.n_cells = hdr.n_cells;
+    v.data_size = hdr.data_size;
+
+    // the file is not trusted - restore() relies on every index being in range
+    // (only the index arrays are read, data pages are faulted in when values are accessed)
+    if (v.offsets[0] != 0 || v.offsets[v.n_cells] != v.data_size)
+        invalid("bad value offsets");
+    for (size_t ci = 0; ci < v.n_cells; ++ci) {
+        // every value (null too) is NUL terminated, so offsets are strictly increasing
+        if (v.offsets[ci + 1] <= v.offsets[ci] || v.offsets[ci + 1] > v.data_size)
+            invalid("bad value offsets");
+    }
+    // terminators of single values are not checked, the last one bounds a scan past a corrupt value
+    if (v.data_size && v.data[v.data_size - 1] != '\0')
+        invalid("bad data section");
+    if (v.rows[0] != 0 || v.rows[v.n_rows] != v.n_cells)
+        invalid("bad row indexes");
+    for (size_t ri = 0; ri < v.n_rows; ++ri) {
+        if (v.rows[ri + 1] < v.rows[ri] || v.rows[ri + 1] > v.n_cells)
+            invalid("bad row indexes");
+    }
+
+    auto a = std::make_shared<arena>();
+    a->file = std::move(file);
+    a->mapped = v;
+
+    arena_ = std::move(a);
+    set_field_names(std::move(fnames));
+}
+
 DBM_INLINE sql_fields const& sql_rows_dump::field_names() const noexcept
 {
     return fnames_;
@@ -110,36 +359,121 @@ DBM_INLINE sql_field_map const& sql_rows_dump::field_map() const noexcept
 
 DBM_INLINE size_t sql_rows_dump::size() const noexcept
 {
-    return data_.size();
+    return arena_ ? arena_->view().n_rows : 0;
 }
 
 DBM_INLINE bool sql_rows_dump::empty() const noexcept
 {
-    return data_.empty();
+    return size() == 0;
 }
 
 DBM_INLINE void sql_rows_dump::clear()
 {
-    data_.clear();
-    data_.shrink_to_fit();
+    arena_.reset();
     fnames_.clear();
     fmap_.clear();
 }
 
+DBM_INLINE size_t sql_rows_dump::num_values() const noexcept
+{
+    return arena_ ? arena_->view().n_cells : 0;
+}
+
+DBM_INLINE size_t sql_rows_dump::data_size() const noexcept
+{
+    return arena_ ? arena_->view().data_size : 0;
+}
+
+DBM_INLINE bool sql_rows_dump::is_mapped() const noexcept
+{
+    return arena_ && arena_->file;
+}
+
+DBM_INLINE sql_rows_dump::arena_view sql_rows_dump::arena::view() const noexcept
+{
+    if (file)
+        return mapped;
+
+    return {data.data(), offsets.data(), rows.data(), nulls.data(), rows.size() - 1, offsets.size() - 1, data.size()};
+}
+
+template<typename Vec>
+DBM_INLINE void sql_rows_dump::grow(Vec& v, size_t n)
+{
+    // geometric growth so repeated appends do not reallocate on every call
+    size_t const required = v.size() + n;
+    if (required > v.capacity()) {
+        v.reserve(std::max(required, v.capacity() * 2));
+    }
+}
+
+DBM_INLINE sql_rows_dump::arena& sql_rows_dump::writable_arena()
+{
+    if (!arena_) {
+        arena_ = std::make_shared<arena>();
+    }
+    else if (arena_->file) {
+        // copy mapped data into memory
+        auto const v = arena_->view();
+        auto a = std::make_shared<arena>();
+        a->data.assign(v.data, v.data + v.data_size);
+        a->offsets.assign(v.offsets, v.offsets + v.n_cells + 1);
+        a->rows.assign(v.rows, v.rows + v.n_rows + 1);
+        a->nulls.assign(v.nulls, v.nulls + nulls_size(v.n_cells));
+        arena_ = std::move(a);
+    }
+    else if (arena_.use_count() > 1) {
+        // restored rows or dump copies are pointing to the current arena
+        arena_ = std::make_shared<arena>(*arena_);
+    }
+    return *arena_;
+}
+
 DBM_INLINE void sql_rows_dump::append(const sql_rows& src)
 {
+    auto& a = writable_arena();
+
+    // size everything up front - one allocation per buffer
+    size_t n_cells = 0;
+    size_t n_bytes = 0;
     for (auto const& src_row : src) {
-        auto& row = data_.emplace_back();
+        n_cells += src_row.size();
+        for (auto const& src_val : src_row) {
+            n_bytes += src_val.length() + 1;
+        }
+    }
+
+    size_t cell = a.rows.back();
 
+    grow(a.data, n_bytes);
+    grow(a.offsets, n_cells);
+    grow(a.rows, src.size());
+    a.nulls.resize(nulls_size(cell + n_cells), 0);
+
+    for (auto const& src_row : src) {
         for (auto const& src_val : src_row) {
             if (src_val.null()) {
-                row.emplace_back(std::nullopt);
+                a.nulls[cell >> 6] |= uint64_t(1) << (cell & 63);
             }
             else {
-                std::string s(src_val.get().data(), src_val.length());
-                row.emplace_back(std::move(s));
+                auto v = src_val.get();
+                a.data.insert(a.data.end(), v.data(), v.data() + src_val.length());
             }
+            a.data.push_back('\0');
+            a.offsets.push_back(a.data.size());
+            ++cell;
         }
+        a.rows.push_back(cell);
+    }
+}
+
+DBM_INLINE void sql_rows_dump::set_field_names(sql_fields&& fnames)
+{
+    fmap_.clear();
+    fnames_ = std::move(fnames);
+
+    for (int i = 0; i < static_cast<int>(fnames_.size()); i++) {
+        fmap_[fnames_[i]] = i;
     }
 }
 
@@ -5,5 +5,6 @@
 #include <dbm/sql_row.hpp>
 #include <dbm/sql_rows.hpp>
 #include <dbm/sql_rows_dump.hpp>
+#include <dbm/sql_result.hpp>
 
 #endif //DBM_SQL_TYPES_HPP
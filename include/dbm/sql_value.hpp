@@ -2,6 +2,7 @@
 #define DBM_SQL_VALUE_HPP
 
 #include <dbm/dbm_common.hpp>
+#include <dbm/column_id.hpp>
 
 namespace dbm::kind {
 
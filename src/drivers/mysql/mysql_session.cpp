@@ -21,7 +21,6 @@
 #include <cstring>
 
 #define MYSQL_CONNECTION_HANDLE (reinterpret_cast<MYSQL*>(conn_))
-#define MYSQL_RES_HANDLE (reinterpret_cast<MYSQL_RES*>(res_set_))
 
 namespace dbm {
 
@@ -51,6 +50,8 @@ mysql_session& mysql_session::operator=(mysql_session&& oth) noexcept
         close();
         conn_ = oth.conn_;
         oth.conn_ = nullptr;
+        multi_statements_ = oth.multi_statements_;
+        oth.multi_statements_ = false;
         session::operator=(std::move(oth));
     }
     return *this;
@@ -94,6 +95,8 @@ void mysql_session::connect(
         conn_ = nullptr;
         throw_exception<std::runtime_error>("MySql cannot connect to database " + std::string(db ? db.value().data() : ""));
     }
+
+    multi_statements_ = (client_flag & CLIENT_MULTI_STATEMENTS) != 0;
 }
 
 void mysql_session::close_impl()
@@ -109,7 +112,29 @@ void mysql_session::close_impl()
         conn_ = nullptr;
     }
 
+    multi_statements_ = false;
+
     prepared_stm_handle_.clear();
+    prepared_stm_slots_.clear();
+}
+
+bool mysql_session::ping_impl()
+{
+    if (!MYSQL_CONNECTION_HANDLE)
+        return false;
+
+    free_result_set();
+
+    if (mysql_ping(MYSQL_CONNECTION_HANDLE)) {
+        auto errn = mysql_errno(MYSQL_CONNECTION_HANDLE);
+        if (errn == CR_SERVER_GONE_ERROR || errn == CR_SERVER_LOST) {
+            /* connection lost */
+            close();
+        }
+        return false;
+    }
+
+    return true;
 }
 
 void mysql_session::query_impl(std::string_view statement)
@@ -141,15 +166,12 @@ void mysql_session::query_impl(std::string_view statement)
 
 kind::sql_rows mysql_session::select_rows_impl(std::string_view statement)
 {
-    kind::sql_rows rows;
-    unsigned num_fields = 0;
-
     /* execute query */
-    query(statement);
+    query_impl(statement);
 
     /* grab the result */
-    res_set_ = mysql_store_result(MYSQL_CONNECTION_HANDLE);
-    if (!res_set_) {
+    auto* res = mysql_store_result(MYSQL_CONNECTION_HANDLE);
+    if (!res) {
         if (mysql_field_count(MYSQL_CONNECTION_HANDLE) > 0) {
             throw_exception<std::runtime_error>(std::string("Error processing result set : ") + mysql_error(MYSQL_CONNECTION_HANDLE) + last_statement_info());
         }
@@ -158,15 +180,29 @@ kind::sql_rows mysql_session::select_rows_impl(std::string_view statement)
         }
     }
 
+    return fetch_rows(res);
+}
+
+kind::sql_rows mysql_session::fetch_rows(void* res)
+{
+    auto* res_handle = reinterpret_cast<MYSQL_RES*>(res);
+    kind::sql_rows rows;
+    unsigned num_fields = 0;
+
+    /* stored result set is owned by the rows (and their copies) so it outlives the next query */
+    rows.set_storage(std::shared_ptr<void>(res, [](void* p) {
+        mysql_free_result(reinterpret_cast<MYSQL_RES*>(p));
+    }));
+
     /* field names */
     {
-        mysql_field_seek(MYSQL_RES_HANDLE, 0);
-        num_fields = mysql_num_fields(MYSQL_RES_HANDLE);
+        mysql_field_seek(res_handle, 0);
+        num_fields = mysql_num_fields(res_handle);
         kind::sql_fields fields_tmp;
         fields_tmp.reserve(num_fields);
 
         for (unsigned i = 0; i < num_fields; i++) {
-            MYSQL_FIELD* field = mysql_fetch_field(MYSQL_RES_HANDLE);
+            MYSQL_FIELD* field = mysql_fetch_field(res_handle);
             fields_tmp.push_back(field->name);
         }
 
@@ -174,15 +210,15 @@ kind::sql_rows mysql_session::select_rows_impl(std::string_view statement)
         rows.set_field_names(std::move(fields_tmp));
     }
 
-    /* fetch rows */
+    /* fetch rows - stored result set knows the number of rows */
+    rows.reserve(static_cast<size_t>(mysql_num_rows(res_handle)), num_fields);
+
     MYSQL_ROW mysql_row;
-    while ((mysql_row = mysql_fetch_row(MYSQL_RES_HANDLE)) != nullptr) {
+    while ((mysql_row = mysql_fetch_row(res_handle)) != nullptr) {
 
         kind::sql_row& r = rows.emplace_back();
-        r.set_fields(&rows.field_names(), &rows.field_map());
-        r.reserve(num_fields);
 
-        unsigned long* lenghts = mysql_fetch_lengths(MYSQL_RES_HANDLE);
+        unsigned long* lenghts = mysql_fetch_lengths(res_handle);
 
         for (unsigned i = 0; i < num_fields; i++) {
             r.emplace_back(mysql_row[i], lenghts[i]);
@@ -198,6 +234,58 @@ kind::sql_rows mysql_session::select_rows_impl(std::string_view statement)
     return rows;
 }
 
+kind::sql_results mysql_session::select_multi(std::string_view statements)
+{
+    kind::sql_results results;
+
+    query_multi(statements, [&results](kind::sql_result& res) {
+        results.push_back(std::move(res));
+    });
+
+    return results;
+}
+
+void mysql_session::query_multi(std::string_view statements, std::function<void(kind::sql_result&)> const& handler)
+{
+    if (!MYSQL_CONNECTION_HANDLE)
+        throw_exception<std::runtime_error>("MySQL connection not established!");
+
+    /* multi statements enabled for this call only are disabled again, also on error */
+    bool enabled = enable_multi_statements();
+    utils::execute_at_exit finally([this, enabled] {
+        if (enabled)
+            disable_multi_statements();
+    });
+
+    /* execute all statements at once - the first result is ready when query returns */
+    query(statements);
+
+    int status;
+    do {
+        kind::sql_result result;
+
+        auto* res = mysql_store_result(MYSQL_CONNECTION_HANDLE);
+        if (res) {
+            result.rows = fetch_rows(res);
+        }
+        else if (mysql_field_count(MYSQL_CONNECTION_HANDLE) > 0) {
+            throw_exception<std::runtime_error>(std::string("Error processing result set : ") + mysql_error(MYSQL_CONNECTION_HANDLE) + last_statement_info());
+        }
+
+        result.affected_rows = mysql_affected_rows(MYSQL_CONNECTION_HANDLE);
+        handler(result);
+
+        /* 0 - more results, -1 - no more results, >0 - error */
+        status = mysql_next_result(MYSQL_CONNECTION_HANDLE);
+        if (status > 0) {
+            throw_exception<std::runtime_error>(std::string("MySql multi statement query error : ")
+                                                + mysql_error(MYSQL_CONNECTION_HANDLE)
+                                                + std::string(" (") + std::to_string(mysql_errno(MYSQL_CONNECTION_HANDLE))
+                                                + std::string(")") + last_statement_info());
+        }
+    } while (status == 0);
+}
+
 void mysql_session::init_prepared_statement_impl(kind::prepared_statement& stmt)
 {
     if (stmt.native_handle())
@@ -478,18 +566,38 @@ void mysql_session::transaction_rollback_impl()
     query("ROLLBACK");
 }
 
+bool mysql_session::enable_multi_statements()
+{
+    if (multi_statements_)
+        return false;
+
+    if (mysql_set_server_option(MYSQL_CONNECTION_HANDLE, MYSQL_OPTION_MULTI_STATEMENTS_ON))
+        throw_exception<std::runtime_error>("MySql cannot enable multi statements : " + last_mysql_error());
+
+    return true;
+}
+
+void mysql_session::disable_multi_statements()
+{
+    if (!MYSQL_CONNECTION_HANDLE)
+        return;
+
+    /* pending results of a failed statement would make the option command out of sync */
+    free_result_set();
+
+    /* connection accepting stacked statements must not be reused by plain queries */
+    if (mysql_set_server_option(MYSQL_CONNECTION_HANDLE, MYSQL_OPTION_MULTI_STATEMENTS_OFF))
+        close_impl();
+}
+
 void mysql_session::free_result_set()
 {
-    if (res_set_) {
-        mysql_free_result(MYSQL_RES_HANDLE);
-        res_set_ = nullptr;
-
-        /* this should be called in case of procedures CALL (error 2014) */
-        while (mysql_next_result(MYSQL_CONNECTION_HANDLE) == 0) {
-            res_set_ = mysql_store_result(MYSQL_CONNECTION_HANDLE);
-            if (res_set_) {
-                mysql_free_result(MYSQL_RES_HANDLE);
-                res_set_ = nullptr;
+    /* discard pending results - this should be called in case of procedures CALL (error 2014) */
+    if (MYSQL_CONNECTION_HANDLE) {
+        while (mysql_more_results(MYSQL_CONNECTION_HANDLE) && mysql_next_result(MYSQL_CONNECTION_HANDLE) == 0) {
+            auto* res = mysql_store_result(MYSQL_CONNECTION_HANDLE);
+            if (res) {
+                mysql_free_result(res);
             }
         }
     }
@@ -74,15 +74,102 @@ sqlite_session::~sqlite_session()
 
 void sqlite_session::connect(std::string_view db_file_name)
 {
-    int rc = sqlite3_open(db_file_name.data(), &db3_);
+    connect(db_file_name, {});
+}
+
+void sqlite_session::connect(std::string_view db_file_name, sqlite_options const& opts)
+{
+    int flags = opts.read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE;
+
+    if (opts.create && !opts.read_only)
+        flags |= SQLITE_OPEN_CREATE;
+    if (opts.uri)
+        flags |= SQLITE_OPEN_URI;
+
+    switch (opts.threading) {
+        case sqlite_options::threading_mode::multi_thread:
+            flags |= SQLITE_OPEN_NOMUTEX;
+            break;
+        case sqlite_options::threading_mode::serialized:
+            flags |= SQLITE_OPEN_FULLMUTEX;
+            break;
+        default:
+            break;
+    }
+
+    std::string file_name(db_file_name);
+
+    int rc = sqlite3_open_v2(file_name.c_str(), &db3_, flags, nullptr);
     if (rc) {
-        throw_exception<std::runtime_error>("SQLite can't open database " + std::string(db_file_name));
+        // a database handle is allocated even if open fails
+        close();
+        throw_exception<std::runtime_error>("SQLite can't open database " + file_name);
+    }
+
+    try {
+        apply_options(opts);
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+void sqlite_session::apply_options(sqlite_options const& opts)
+{
+    if (opts.busy_handler) {
+        busy_handler_ = opts.busy_handler;
+        sqlite3_busy_handler(db3_, [](void* ctx, int count) -> int {
+            return (*reinterpret_cast<std::function<bool(int)>*>(ctx))(count) ? 1 : 0;
+        }, &busy_handler_);
+    }
+    else if (opts.busy_timeout) {
+        sqlite3_busy_timeout(db3_, static_cast<int>(opts.busy_timeout->count()));
+    }
+
+    if (opts.journal_mode) {
+        switch (*opts.journal_mode) {
+            case sqlite_options::journal_mode::del:      query("PRAGMA journal_mode=DELETE"); break;
+            case sqlite_options::journal_mode::truncate: query("PRAGMA journal_mode=TRUNCATE"); break;
+            case sqlite_options::journal_mode::persist:  query("PRAGMA journal_mode=PERSIST"); break;
+            case sqlite_options::journal_mode::memory:   query("PRAGMA journal_mode=MEMORY"); break;
+            case sqlite_options::journal_mode::wal:      query("PRAGMA journal_mode=WAL"); break;
+            case sqlite_options::journal_mode::off:      query("PRAGMA journal_mode=OFF"); break;
+        }
+    }
+
+    if (opts.synchronous) {
+        switch (*opts.synchronous) {
+            case sqlite_options::synchronous::off:    query("PRAGMA synchronous=OFF"); break;
+            case sqlite_options::synchronous::normal: query("PRAGMA synchronous=NORMAL"); break;
+            case sqlite_options::synchronous::full:   query("PRAGMA synchronous=FULL"); break;
+            case sqlite_options::synchronous::extra:  query("PRAGMA synchronous=EXTRA"); break;
+        }
+    }
+
+    if (opts.mmap_size) {
+        query("PRAGMA mmap_size=" + std::to_string(*opts.mmap_size));
+    }
+
+    if (opts.cache_size) {
+        query("PRAGMA cache_size=" + std::to_string(*opts.cache_size));
+    }
+
+    if (opts.query_only) {
+        query("PRAGMA query_only=1");
+    }
+
+    if (opts.temp_store) {
+        switch (*opts.temp_store) {
+            case sqlite_options::temp_store::defaults: query("PRAGMA temp_store=DEFAULT"); break;
+            case sqlite_options::temp_store::file:     query("PRAGMA temp_store=FILE"); break;
+            case sqlite_options::temp_store::memory:   query("PRAGMA temp_store=MEMORY"); break;
+        }
     }
 }
 
 void sqlite_session::close_impl()
 {
-    free_table();
     destroy_prepared_stmt_handles();
 
     if (db3_) {
@@ -91,6 +178,12 @@ void sqlite_session::close_impl()
     }
 }
 
+bool sqlite_session::ping_impl()
+{
+    // there is no server, an open database handle is always usable
+    return db3_ != nullptr;
+}
+
 void sqlite_session::query_impl(std::string_view statement)
 {
     error_message zErrMsg;
@@ -112,9 +205,9 @@ kind::sql_rows sqlite_session::select_rows_impl(std::string_view statement)
     error_message zErrMsg;
     kind::sql_rows rows;
 
-    last_statement_ = statement;
+    char** azResult {nullptr};
 
-    free_table();
+    last_statement_ = statement;
 
     /* query */
     rc = sqlite3_get_table(db3_, statement.data(), &azResult, &nRow, &nColumn, zErrMsg.ptr());
@@ -122,6 +215,11 @@ kind::sql_rows sqlite_session::select_rows_impl(std::string_view statement)
         throw_exception<std::runtime_error>("SQLite error " + zErrMsg.to_string() + last_statement_info());
     }
 
+    /* result table is owned by the rows (and their copies) so it outlives the next query */
+    rows.set_storage(std::shared_ptr<void>(azResult, [](void* p) {
+        sqlite3_free_table(static_cast<char**>(p));
+    }));
+
     /* field names */
     {
         kind::sql_fields fields_tmp;
@@ -135,11 +233,12 @@ kind::sql_rows sqlite_session::select_rows_impl(std::string_view statement)
     }
 
     /* fetch rows */
+    rows.reserve(nRow, nColumn);
+
     int i = nColumn;
     for (int ri = 1; ri < nRow + 1; ri++) {
 
         kind::sql_row& r = rows.emplace_back();
-        r.set_fields(&rows.field_names(), &rows.field_map());
 
         for (int ci = 0; ci < nColumn; ci++) {
             r.emplace_back(azResult[i], azResult[i] ? strlen(azResult[i]) : 0);
@@ -189,8 +288,6 @@ void sqlite_session::query_impl(kind::prepared_statement& stmt)
     if (!db3_)
         throw_exception("SQLite connection is closed");
 
-    free_table();
-
     if (!stmt.native_handle())
         init_prepared_statement(stmt);
 
@@ -266,8 +363,6 @@ std::vector<std::vector<container_ptr>> sqlite_session::select_impl(dbm::kind::p
     if (!db3_)
         throw_exception("SQLite connection is closed");
 
-    free_table();
-
     if (!stmt.native_handle())
         init_prepared_statement(stmt);
 
@@ -381,14 +476,6 @@ void sqlite_session::transaction_rollback_impl()
 }
 
 
-void sqlite_session::free_table()
-{
-    if (azResult) {
-        sqlite3_free_table(azResult);
-        azResult = nullptr;
-    }
-}
-
 void sqlite_session::destroy_prepared_stmt_handles()
 {
     for (auto& h : prepared_stm_handle_) {
@@ -396,6 +483,7 @@ void sqlite_session::destroy_prepared_stmt_handles()
     }
 
     prepared_stm_handle_.clear();
+    prepared_stm_slots_.clear();
 }
 
 }// namespace dbm
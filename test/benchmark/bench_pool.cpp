@@ -0,0 +1,87 @@
+#include "benchmark.h"
+
+#ifdef DBM_SQLITE3
+
+#include <dbm/dbm.hpp>
+#include <dbm/drivers/sqlite/sqlite_session.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+size_t n_acquires = 200000;
+
+struct make_session
+{
+    std::shared_ptr<dbm::sqlite_session> operator()()
+    {
+        auto s = std::make_shared<dbm::sqlite_session>();
+        s->connect(":memory:");
+        return s;
+    }
+};
+
+using bench_pool = dbm::pool<dbm::sqlite_session, make_session>;
+
+void run_acquire_release(size_t n_threads, size_t max_conn)
+{
+    bench_pool pool;
+    pool.set_max_connections(max_conn);
+    pool.set_acquire_timeout(std::chrono::seconds(60));
+
+    // create connections up front
+    {
+        std::vector<bench_pool::pool_connection_type> conns;
+        for (size_t i = 0; i < max_conn; ++i) {
+            conns.push_back(pool.acquire());
+        }
+    }
+
+    size_t n_per_thread = n_acquires / n_threads;
+
+    bench::run("acquire/release (" + std::to_string(n_threads) + " threads, " + std::to_string(max_conn) + " conn)", n_per_thread * n_threads, [&] {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < n_threads; ++t) {
+            threads.emplace_back([&] {
+                for (size_t i = 0; i < n_per_thread; ++i) {
+                    auto conn = pool.acquire();
+                    bench::do_not_optimize(&conn.get());
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) {
+        // scale factor
+        n_acquires = static_cast<size_t>(n_acquires * std::stod(argv[1]));
+    }
+
+    size_t n_cpu = std::max(1u, std::thread::hardware_concurrency());
+
+    std::printf("pool\n");
+    run_acquire_release(1, 1);
+    run_acquire_release(n_cpu, 64);
+    run_acquire_release(64, 64);
+    run_acquire_release(64, 8);
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    std::printf("SQLite not available\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,251 @@
+#include "benchmark.h"
+#include <dbm/dbm.hpp>
+#include <cstdio>
+
+namespace {
+
+size_t n_rows = 200000;
+size_t n_column_rows = 1000000;
+constexpr size_t n_cols = 6;
+
+// Builds a result set resembling a driver result (values point into an external buffer)
+struct source_rows
+{
+    std::vector<std::string> values;
+    dbm::sql_rows rows;
+
+    source_rows()
+    {
+        values.reserve(n_rows * n_cols);
+        for (size_t i = 0; i < n_rows; ++i) {
+            values.push_back(std::to_string(i));
+            values.push_back("name_" + std::to_string(i));
+            values.push_back(std::to_string(i * 0.25));
+            values.push_back(std::to_string(i % 100));
+            values.push_back("2021-01-01 12:00:00");
+            values.push_back(i % 7 ? "some longer text value" : "");
+        }
+
+        rows.set_field_names({"id", "name", "price", "quantity", "created", "note"});
+        rows.reserve(n_rows);
+        for (size_t i = 0; i < n_rows; ++i) {
+            auto& row = rows.emplace_back();
+            row.reserve(n_cols);
+            for (size_t c = 0; c < n_cols; ++c) {
+                auto const& v = values[i * n_cols + c];
+                if (c == n_cols - 1 && v.empty())
+                    row.emplace_back(nullptr, 0);
+                else
+                    row.emplace_back(v.c_str(), v.size());
+            }
+        }
+    }
+};
+
+void bench_rows(source_rows const& src)
+{
+    std::printf("sql_rows (%zu rows x %zu columns)\n", n_rows, n_cols);
+
+    dbm::sql_rows rows;
+    bench::run("build", n_rows, [&] {
+        rows.set_field_names(dbm::kind::sql_fields(src.rows.field_names()));
+        rows.reserve(n_rows, n_cols);
+        for (auto const& src_row : src.rows) {
+            auto& row = rows.emplace_back();
+            for (auto const& v : src_row) {
+                row.emplace_back(v);
+            }
+        }
+    });
+
+    bench::run("copy", n_rows, [&] {
+        dbm::sql_rows copy = rows;
+        bench::do_not_optimize(copy.size());
+    });
+
+    constexpr size_t n_moves = 1000;
+    bench::run("move (x" + std::to_string(n_moves) + ")", n_moves, [&] {
+        for (size_t i = 0; i < n_moves; ++i) {
+            dbm::sql_rows tmp = std::move(rows);
+            rows = std::move(tmp);
+        }
+        bench::do_not_optimize(rows.size());
+    });
+
+    bench::run("iterate", n_rows * n_cols, [&] {
+        size_t n = 0;
+        for (auto const& row : rows) {
+            for (auto const& v : row) {
+                n += v.length();
+            }
+        }
+        bench::do_not_optimize(n);
+    });
+}
+
+void bench_columns()
+{
+    // values point to a small pool of strings so 1M rows stay cheap to build
+    std::vector<std::string> pool;
+    for (int i = 0; i < 1000; ++i) {
+        pool.push_back(std::to_string(i));
+    }
+
+    dbm::sql_rows rows;
+    rows.set_field_names({"id", "name", "price", "quantity", "created", "note"});
+    rows.reserve(n_column_rows, n_cols);
+    for (size_t i = 0; i < n_column_rows; ++i) {
+        auto& row = rows.emplace_back();
+        for (size_t c = 0; c < n_cols; ++c) {
+            auto const& v = pool[(i + c) % pool.size()];
+            row.emplace_back(v.c_str(), v.size());
+        }
+    }
+
+    std::printf("column access (%zu rows)\n", n_column_rows);
+
+    bench::run("row.at(\"price\")", n_column_rows, [&] {
+        size_t n = 0;
+        for (auto const& row : rows) {
+            n += row.at("price").length();
+        }
+        bench::do_not_optimize(n);
+    });
+
+    bench::run("row.at(column_id)", n_column_rows, [&] {
+        dbm::kind::column_id price("price");
+        size_t n = 0;
+        for (auto const& row : rows) {
+            n += row.at(price).length();
+        }
+        bench::do_not_optimize(n);
+    });
+
+    bench::run("row[rows.column(\"price\")]", n_column_rows, [&] {
+        auto price = rows.column("price");
+        size_t n = 0;
+        for (auto const& row : rows) {
+            n += row[price].length();
+        }
+        bench::do_not_optimize(n);
+    });
+
+    bench::run("sum price: get<double>() per value", n_column_rows, [&] {
+        auto price = rows.column("price");
+        double sum = 0;
+        for (auto const& row : rows) {
+            sum += row[price].get<double>();
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    bench::run("sum price: column_as<double>()", n_column_rows, [&] {
+        auto price = rows.column_as<double>("price");
+        double sum = 0;
+        for (double v : price.values) {
+            sum += v;
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    bench::run("sum id: get<int64_t>() per value", n_column_rows, [&] {
+        auto id = rows.column("id");
+        int64_t sum = 0;
+        for (auto const& row : rows) {
+            sum += row[id].get<int64_t>();
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    bench::run("sum id: column_as<int64_t>()", n_column_rows, [&] {
+        auto id = rows.column_as<int64_t>("id");
+        int64_t sum = 0;
+        for (int64_t v : id.values) {
+            sum += v;
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    dbm::model m("bench",
+                 {
+                     { dbm::key("id"), dbm::local<int>() },
+                     { dbm::key("name"), dbm::local<std::string>() },
+                     { dbm::key("price"), dbm::local<double>() },
+                     { dbm::key("quantity"), dbm::local<int>() }
+                 });
+
+    bench::run("model << row", n_column_rows, [&] {
+        for (auto const& row : rows) {
+            m << row;
+        }
+        bench::do_not_optimize(m);
+    });
+}
+
+void bench_dump(source_rows const& src)
+{
+    std::printf("sql_rows_dump (%zu rows x %zu columns)\n", n_rows, n_cols);
+
+    dbm::sql_rows_dump dump;
+    bench::run("store", n_rows, [&] {
+        dump.store(src.rows);
+    });
+    bench::do_not_optimize(dump.data_size());
+
+    bench::run("append (100 batches)", n_rows, [&] {
+        dbm::sql_rows_dump d;
+        dbm::sql_rows batch;
+        batch.set_field_names(dbm::kind::sql_fields(src.rows.field_names()));
+        size_t const n_batch = n_rows / 100;
+        for (size_t b = 0; b < 100; ++b) {
+            batch.clear();
+            for (size_t i = b * n_batch; i < (b + 1) * n_batch; ++i) {
+                auto& row = batch.emplace_back();
+                for (auto const& v : src.rows[i]) {
+                    row.emplace_back(v);
+                }
+            }
+            d += batch;
+        }
+        bench::do_not_optimize(d.size());
+    });
+
+    bench::run("restore", n_rows, [&] {
+        auto rows = dump.restore();
+        bench::do_not_optimize(rows.size());
+    });
+
+    constexpr const char* file_name = "dbm_bench_rows.dump";
+
+    bench::run("save", n_rows, [&] {
+        dump.save(file_name);
+    });
+
+    bench::run("load_mmap + restore", n_rows, [&] {
+        dbm::sql_rows_dump d;
+        d.load_mmap(file_name);
+        auto rows = d.restore();
+        bench::do_not_optimize(rows.size());
+    });
+
+    std::remove(file_name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) {
+        // scale factor
+        double scale = std::stod(argv[1]);
+        n_rows = static_cast<size_t>(n_rows * scale);
+        n_column_rows = static_cast<size_t>(n_column_rows * scale);
+    }
+
+    source_rows src;
+    bench_rows(src);
+    bench_columns();
+    bench_dump(src);
+
+    return 0;
+}
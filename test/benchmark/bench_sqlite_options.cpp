@@ -0,0 +1,139 @@
+#include "benchmark.h"
+
+#ifdef DBM_SQLITE3
+
+#include <dbm/dbm.hpp>
+#include <dbm/drivers/sqlite/sqlite_session.hpp>
+#include "../db_settings.h"
+#include <cstdio>
+#include <random>
+#include <thread>
+
+namespace {
+
+constexpr const char* db_file_name = "dbm_bench_options.sqlite3";
+
+size_t n_autocommit = 500;
+size_t n_bulk = 100000;
+size_t n_point = 20000;
+size_t n_threads = 4;
+
+dbm::model get_model()
+{
+    return dbm::model("bench",
+                      {
+                          { dbm::key("id"), dbm::local<int>(), dbm::primary(true), dbm::not_null(true) },
+                          { dbm::key("name"), dbm::local<std::string>() },
+                          { dbm::key("value"), dbm::local<double>() }
+                      });
+}
+
+void point_selects(dbm::sqlite_session& db, size_t n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(1, static_cast<int>(n_bulk));
+
+    for (size_t i = 0; i < n; ++i) {
+        auto rows = db.select("SELECT * FROM bench WHERE id=" + std::to_string(dist(gen)));
+        bench::do_not_optimize(rows.size());
+    }
+}
+
+void run_profile(std::string const& name, dbm::sqlite_options const& opts)
+{
+    std::printf("%s\n", name.c_str());
+
+    remove_sqlite_files(db_file_name);
+
+    dbm::sqlite_session db;
+    db.connect(db_file_name, opts);
+    auto m = get_model();
+    m.create_table(db);
+
+    dbm::prepared_stmt insert("INSERT INTO bench (id, name, value) VALUES (?, ?, ?)",
+                              dbm::local<int>(),
+                              dbm::local<std::string>(),
+                              dbm::local<double>());
+
+    int id = 0;
+
+    auto insert_one = [&] {
+        ++id;
+        insert.param(0)->set(id);
+        insert.param(1)->set("name_" + std::to_string(id));
+        insert.param(2)->set(id * 0.5);
+        db.query(insert);
+    };
+
+    bench::run("insert (autocommit)", n_autocommit, [&] {
+        for (size_t i = 0; i < n_autocommit; ++i) {
+            insert_one();
+        }
+    });
+
+    bench::run("insert (transaction)", n_bulk - n_autocommit, [&] {
+        dbm::sqlite_session::transaction tr(db);
+        for (size_t i = n_autocommit; i < n_bulk; ++i) {
+            insert_one();
+        }
+        tr.commit();
+    });
+
+    bench::run("point select", n_point, [&] {
+        point_selects(db, n_point, 1);
+    });
+
+    bench::run("full scan", n_bulk * 5, [&] {
+        for (int i = 0; i < 5; ++i) {
+            auto rows = db.select("SELECT * FROM bench");
+            bench::do_not_optimize(rows.size());
+        }
+    });
+
+    bench::run("point select (" + std::to_string(n_threads) + " threads)", n_point * n_threads, [&] {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < n_threads; ++t) {
+            threads.emplace_back([&, t] {
+                dbm::sqlite_session reader;
+                reader.connect(db_file_name, opts);
+                point_selects(reader, n_point, static_cast<unsigned>(t));
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    });
+
+    db.close();
+    remove_sqlite_files(db_file_name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) {
+        // scale factor
+        double scale = std::stod(argv[1]);
+        n_autocommit = static_cast<size_t>(n_autocommit * scale);
+        n_bulk = static_cast<size_t>(n_bulk * scale);
+        n_point = static_cast<size_t>(n_point * scale);
+    }
+
+    run_profile("default", {});
+    run_profile("read_heavy", dbm::sqlite_options::read_heavy());
+    run_profile("bulk_load", dbm::sqlite_options::bulk_load());
+    run_profile("durable", dbm::sqlite_options::durable());
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    std::printf("SQLite not available\n");
+    return 0;
+}
+
+#endif
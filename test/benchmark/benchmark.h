@@ -0,0 +1,33 @@
+#ifndef DBM_BENCHMARK_H
+#define DBM_BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace bench {
+
+// Runs fn once and prints number of operations per second
+template<typename Fn>
+double run(std::string const& name, size_t n_ops, Fn&& fn)
+{
+    auto tp1 = std::chrono::steady_clock::now();
+    fn();
+    auto tp2 = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double> dt = tp2 - tp1;
+    double ops = dt.count() > 0 ? n_ops / dt.count() : 0;
+    std::printf("  %-40s %10zu ops %10.3f s %14.0f ops/s\n", name.c_str(), n_ops, dt.count(), ops);
+    return ops;
+}
+
+// Prevents compiler from optimizing out the result
+template<typename T>
+void do_not_optimize(T const& val)
+{
+    asm volatile("" : : "r,m"(val) : "memory");
+}
+
+} // namespace bench
+
+#endif //DBM_BENCHMARK_H
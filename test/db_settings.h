@@ -2,6 +2,8 @@
 #define DBM_DB_SETTINGS_H
 
 #include <dbm/dbm.hpp>
+#include <cstdio>
+#include <string>
 #ifdef DBM_MYSQL
 #include <dbm/drivers/mysql/mysql_session.hpp>
 #endif
@@ -82,6 +84,14 @@ struct MakeSQLiteSession
 };
 
 using SQLitePool = dbm::pool<dbm::sqlite_session, MakeSQLiteSession>;
+
+// Removes SQLite database file together with its WAL and shared memory files
+inline void remove_sqlite_files(std::string const& file_name)
+{
+    std::remove(file_name.c_str());
+    std::remove((file_name + "-wal").c_str());
+    std::remove((file_name + "-shm").c_str());
+}
 #endif
 
 #endif //DBM_DB_SETTINGS_H
@@ -0,0 +1,257 @@
+#if defined(DBM_COROUTINES) && defined(DBM_SQLITE3)
+
+#include "dbm/dbm.hpp"
+#include "db_settings.h"
+#include "common.h"
+#include <dbm/drivers/sqlite/sqlite_session.hpp>
+#include <future>
+#include <queue>
+
+using namespace boost::unit_test;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Single thread executor for blocking database calls
+class worker
+{
+public:
+    worker()
+        : thr_([this] { run(); })
+    {}
+
+    ~worker()
+    {
+        {
+            std::lock_guard lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thr_.join();
+    }
+
+    void post(std::function<void()> job)
+    {
+        {
+            std::lock_guard lock(mtx_);
+            jobs_.push(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    std::thread::id id() const { return thr_.get_id(); }
+
+private:
+    void run()
+    {
+        while (true) {
+            std::unique_lock lock(mtx_);
+            cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty())
+                return;
+            auto job = std::move(jobs_.front());
+            jobs_.pop();
+            lock.unlock();
+            job();
+        }
+    }
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> jobs_;
+    bool stop_ {false};
+    std::thread thr_;
+};
+
+detached_task select_one(SQLitePool& pool, std::promise<size_t> done)
+{
+    try {
+        size_t n;
+        {
+            auto conn = co_await pool.co_acquire();
+            n = (co_await conn.co_select("SELECT 1")).size();
+        }
+        done.set_value(n);
+    }
+    catch (...) {
+        done.set_exception(std::current_exception());
+    }
+}
+
+detached_task acquire_priority(SQLitePool& pool, dbm::pool_priority priority, SQLitePool::time_point deadline,
+                               std::vector<dbm::pool_priority>& order, std::promise<void> done)
+{
+    try {
+        auto conn = co_await pool.co_acquire(priority, deadline);
+        order.push_back(priority);
+        done.set_value();
+    }
+    catch (...) {
+        done.set_exception(std::current_exception());
+    }
+}
+
+detached_task select_thread_id(SQLitePool& pool, std::promise<std::thread::id> done)
+{
+    {
+        auto conn = co_await pool.co_acquire();
+        co_await conn.co_select("SELECT 1");
+    }
+    done.set_value(std::this_thread::get_id());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TstCoro)
+
+BOOST_AUTO_TEST_CASE(co_acquire_idle)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+
+    std::promise<size_t> done;
+    auto res = done.get_future();
+    select_one(pool, std::move(done));
+
+    // no executor - coroutine completes without suspending
+    BOOST_TEST((res.wait_for(0s) == std::future_status::ready));
+    BOOST_TEST(res.get() == 1);
+    BOOST_TEST(pool.num_connections() == 1);
+    BOOST_TEST(pool.num_idle_connections() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(co_acquire_handover)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+
+    auto conn = pool.acquire();
+
+    std::promise<size_t> done;
+    auto res = done.get_future();
+    select_one(pool, std::move(done));
+
+    // coroutine is suspended until connection is released
+    BOOST_TEST((res.wait_for(200ms) == std::future_status::timeout));
+    BOOST_TEST(pool.stat().n_acquiring == 1);
+
+    conn.release();
+    BOOST_TEST((res.wait_for(0s) == std::future_status::ready));
+    BOOST_TEST(res.get() == 1);
+    BOOST_TEST(pool.num_connections() == 1);
+    BOOST_TEST(pool.num_idle_connections() == 1);
+    BOOST_TEST(pool.stat().n_acquiring == 0);
+}
+
+BOOST_AUTO_TEST_CASE(co_acquire_timeout)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+    pool.set_acquire_timeout(500ms);
+
+    auto conn = pool.acquire();
+
+    std::promise<size_t> done;
+    auto res = done.get_future();
+    select_one(pool, std::move(done));
+
+    BOOST_TEST((res.wait_for(2s) == std::future_status::ready));
+    BOOST_REQUIRE_THROW(res.get(), std::exception);
+    BOOST_TEST(pool.stat().n_timeouts == 1);
+    BOOST_TEST(pool.stat().n_acquiring == 0);
+
+    // short timeout is not delayed until the next background thread poll
+    pool.set_acquire_timeout(20ms);
+    std::promise<size_t> done_short;
+    res = done_short.get_future();
+    auto started = std::chrono::steady_clock::now();
+    select_one(pool, std::move(done_short));
+
+    BOOST_TEST((res.wait_for(2s) == std::future_status::ready));
+    BOOST_TEST((std::chrono::steady_clock::now() - started < 150ms));
+    BOOST_REQUIRE_THROW(res.get(), std::exception);
+    BOOST_TEST(pool.stat().n_timeouts == 2);
+}
+
+BOOST_AUTO_TEST_CASE(co_acquire_priority)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+
+    auto conn = pool.acquire();
+    auto now = std::chrono::steady_clock::now();
+    std::vector<dbm::pool_priority> order;
+
+    std::promise<void> low_done, high_done, rejected_done;
+    auto low = low_done.get_future();
+    auto high = high_done.get_future();
+    auto rejected = rejected_done.get_future();
+    acquire_priority(pool, dbm::pool_priority::low, SQLitePool::time_point::max(), order, std::move(low_done));
+    acquire_priority(pool, dbm::pool_priority::high, now + 2s, order, std::move(high_done));
+    acquire_priority(pool, dbm::pool_priority::high, now - 1ms, order, std::move(rejected_done));
+
+    // expired deadline is rejected without suspending
+    BOOST_TEST((rejected.wait_for(0s) == std::future_status::ready));
+    BOOST_REQUIRE_THROW(rejected.get(), std::exception);
+    BOOST_TEST(pool.stat().n_acquiring == 2);
+
+    conn.release();
+    BOOST_TEST((high.wait_for(0s) == std::future_status::ready));
+    BOOST_TEST((low.wait_for(0s) == std::future_status::ready));
+    BOOST_TEST(order.size() == 2);
+    BOOST_TEST((order.front() == dbm::pool_priority::high));
+}
+
+BOOST_AUTO_TEST_CASE(co_executor)
+{
+    worker w;
+    SQLitePool pool;
+    pool.set_max_connections(1);
+    pool.set_coro_executor([&w](std::function<void()> job) {
+        w.post(std::move(job));
+    });
+
+    std::promise<std::thread::id> done;
+    auto res = done.get_future();
+    select_thread_id(pool, std::move(done));
+
+    BOOST_TEST((res.wait_for(2s) == std::future_status::ready));
+    BOOST_TEST((res.get() == w.id()));
+}
+
+BOOST_AUTO_TEST_CASE(co_executor_inline)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+
+    // the coroutine finishes before the job returns, the executor state must outlive it
+    auto n_jobs = std::make_shared<int>(0);
+    pool.set_coro_executor([n_jobs](std::function<void()> job) {
+        job();
+        ++*n_jobs;
+    });
+
+    std::promise<std::thread::id> done;
+    auto res = done.get_future();
+    select_thread_id(pool, std::move(done));
+
+    BOOST_TEST((res.wait_for(0s) == std::future_status::ready));
+    BOOST_TEST((res.get() == std::this_thread::get_id()));
+    BOOST_TEST(*n_jobs >= 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
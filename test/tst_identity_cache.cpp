@@ -0,0 +1,373 @@
+#ifdef DBM_SQLITE3
+
+#include "dbm/dbm.hpp"
+#include "db_settings.h"
+#include "common.h"
+#include <dbm/drivers/sqlite/sqlite_session.hpp>
+#include <dbm/drivers/sqlite/sqlite_pool.hpp>
+#include <thread>
+
+using namespace boost::unit_test;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr const char* db_file_name = "dbm_test_identity.sqlite3";
+
+dbm::model get_model()
+{
+    return dbm::model("test_identity",
+                      {
+                          { dbm::key("id"), dbm::local<int>(), dbm::primary(true), dbm::not_null(true) },
+                          { dbm::key("name"), dbm::local<std::string>() },
+                          { dbm::key("value"), dbm::local<int>() }
+                      });
+}
+
+void write(dbm::sqlite_session& db, int id, std::string const& name, int value)
+{
+    auto m = get_model();
+    m.at("id").set_value(id);
+    m.at("name").set_value(name);
+    m.at("value").set_value(value);
+    m.write_record(db);
+}
+
+std::string read_name(dbm::sqlite_session& db, int id)
+{
+    auto m = get_model();
+    m.at("id").set_value(id);
+    m.read_record(db);
+    return m.at("name").value<std::string>();
+}
+
+void init_db(dbm::sqlite_session& db)
+{
+    remove_sqlite_files(db_file_name);
+    db.connect(db_file_name);
+    get_model().create_table(db);
+    write(db, 1, "a", 1);
+    write(db, 2, "b", 2);
+    write(db, 3, "c", 3);
+}
+
+std::shared_ptr<dbm::identity_cache> make_cache(size_t capacity = 1000,
+                                                dbm::identity_cache::eviction_policy policy = dbm::identity_cache::eviction_policy::lru,
+                                                size_t n_shards = 4,
+                                                bool write_through = false)
+{
+    dbm::identity_cache::config cfg;
+    cfg.capacity = capacity;
+    cfg.n_shards = n_shards;
+    cfg.policy = policy;
+    cfg.write_through = write_through;
+    return std::make_shared<dbm::identity_cache>(cfg);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TstIdentityCache)
+
+BOOST_AUTO_TEST_CASE(read_hit)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    auto cache = make_cache();
+    db.set_identity_cache(cache);
+
+    BOOST_TEST(read_name(db, 1) == "a");
+    BOOST_TEST(cache->stat().misses == 1);
+    BOOST_TEST(cache->stat().entries == 1);
+
+    // change bypassing the cache is not visible
+    dbm::sqlite_session other;
+    other.connect(db_file_name);
+    other.query("UPDATE test_identity SET name = 'x' WHERE id = 1");
+
+    BOOST_TEST(read_name(db, 1) == "a");
+    BOOST_TEST(cache->stat().hits == 1);
+
+    // extra condition is not cached
+    auto m = get_model();
+    m.at("id").set_value(1);
+    m.read_record(db, "value = 1");
+    BOOST_TEST(m.at("name").value<std::string>() == "x");
+    BOOST_TEST(cache->stat().hits == 1);
+
+    // snapshots are shared
+    auto s1 = cache->find(m);
+    auto s2 = cache->find(m);
+    BOOST_TEST(s1);
+    BOOST_TEST(s1 == s2);
+    BOOST_TEST(s1->at(0).at("name").get<std::string>() == "a");
+
+    // model with an item missing in the cached record is read from the database
+    auto m2 = get_model();
+    m2.emplace_back(dbm::key("extra"), dbm::local<int>());
+    m2.at("id").set_value(1);
+    auto hits = cache->stat().hits;
+    BOOST_CHECK_THROW(m2.read_record(db), std::exception);
+    BOOST_TEST(cache->stat().hits == hits);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(write_delete)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    // written record is dropped - the database may store other values than written
+    auto dropping = make_cache();
+    db.set_identity_cache(dropping);
+    BOOST_TEST(read_name(db, 1) == "a");
+    write(db, 1, "aa", 10);
+    BOOST_TEST(dropping->stat().entries == 0);
+    BOOST_TEST(read_name(db, 1) == "aa");
+    BOOST_TEST(dropping->stat().hits == 0);
+
+    auto cache = make_cache(1000, dbm::identity_cache::eviction_policy::lru, 4, true);
+    db.set_identity_cache(cache);
+
+    BOOST_TEST(read_name(db, 1) == "aa");
+
+    // write through - complete record is stored
+    write(db, 1, "aa", 10);
+    auto hits = cache->stat().hits;
+    BOOST_TEST(read_name(db, 1) == "aa");
+    BOOST_TEST(cache->stat().hits == hits + 1);
+
+    // written record is not complete - dropped
+    auto m = get_model();
+    m.at("id").set_value(1);
+    m.at("name").set_value("aaa");
+    m.write_record(db);
+    BOOST_TEST(cache->stat().entries == 0);
+    BOOST_TEST(read_name(db, 1) == "aaa");
+    BOOST_TEST(cache->stat().hits == hits + 1);
+
+    // delete
+    m.delete_record(db);
+    BOOST_TEST(cache->stat().entries == 0);
+    BOOST_CHECK_THROW(read_name(db, 1), std::domain_error);
+
+    // other records are not affected
+    BOOST_TEST(read_name(db, 2) == "b");
+    BOOST_TEST(read_name(db, 2) == "b");
+    BOOST_TEST(cache->stat().hits == hits + 2);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(query_invalidation)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    auto cache = make_cache();
+    db.set_identity_cache(cache);
+
+    BOOST_TEST(read_name(db, 1) == "a");
+    BOOST_TEST(read_name(db, 2) == "b");
+
+    // unrelated table
+    db.query("CREATE TABLE test_identity_other (id INTEGER)");
+    BOOST_TEST(read_name(db, 1) == "a");
+    BOOST_TEST(cache->stat().hits == 1);
+
+    db.query("UPDATE test_identity SET name = upper(name)");
+    BOOST_TEST(read_name(db, 1) == "A");
+    BOOST_TEST(read_name(db, 2) == "B");
+    BOOST_TEST(cache->stat().hits == 1);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(transaction)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    auto cache = make_cache();
+    db.set_identity_cache(cache);
+
+    BOOST_TEST(read_name(db, 1) == "a");
+    {
+        dbm::sqlite_session::transaction tr(db);
+        write(db, 1, "t", 0);
+        BOOST_TEST(read_name(db, 1) == "t");
+        tr.rollback();
+    }
+    BOOST_TEST(read_name(db, 1) == "a");
+
+    {
+        dbm::sqlite_session::transaction tr(db);
+        write(db, 1, "t", 0);
+        tr.commit();
+    }
+    BOOST_TEST(read_name(db, 1) == "t");
+    BOOST_TEST(read_name(db, 1) == "t");
+    BOOST_TEST(cache->stat().hits == 1);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(eviction)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    for (auto policy : {dbm::identity_cache::eviction_policy::lru, dbm::identity_cache::eviction_policy::fifo}) {
+        auto cache = make_cache(2, policy, 1);
+        db.set_identity_cache(cache);
+
+        read_name(db, 1);
+        read_name(db, 2);
+        read_name(db, 1);
+        read_name(db, 3);
+        BOOST_TEST(cache->stat().evictions == 1);
+        BOOST_TEST(cache->stat().entries == 2);
+
+        // lru evicts 2 (1 was used recently), fifo evicts 1 (inserted first)
+        auto m = get_model();
+        m.at("id").set_value(1);
+        BOOST_TEST(!!cache->find(m) == (policy == dbm::identity_cache::eviction_policy::lru));
+        m.at("id").set_value(2);
+        BOOST_TEST(!!cache->find(m) == (policy == dbm::identity_cache::eviction_policy::fifo));
+    }
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(ttl_expiration)
+{
+    for (auto policy : {dbm::identity_cache::eviction_policy::lru, dbm::identity_cache::eviction_policy::fifo}) {
+        dbm::identity_cache::config cfg;
+        cfg.policy = policy;
+        cfg.ttl = 50ms;
+        dbm::identity_cache cache(cfg);
+
+        auto m = get_model();
+        m.at("id").set_value(1);
+        m.at("name").set_value("a");
+        m.at("value").set_value(1);
+
+        std::string key;
+        BOOST_TEST(dbm::identity_cache::make_key(m, key));
+        BOOST_TEST(cache.insert(key, dbm::identity_cache::make_snapshot(m), cache.make_ticket(key)));
+        BOOST_TEST(!!cache.find(key));
+
+        // expired record is dropped on lookup
+        std::this_thread::sleep_for(100ms);
+        BOOST_TEST(!cache.find(key));
+        BOOST_TEST(cache.stat().expirations == 1);
+        BOOST_TEST(cache.stat().entries == 0);
+        BOOST_TEST(cache.stat().misses == 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stale_read_rejected)
+{
+    auto cache = make_cache();
+    auto m = get_model();
+    m.at("id").set_value(1);
+    m.at("name").set_value("old");
+    m.at("value").set_value(1);
+
+    std::string key;
+    BOOST_TEST(dbm::identity_cache::make_key(m, key));
+
+    // reader takes a ticket, writer updates the record before the read result is stored
+    auto read_ticket = cache->make_ticket(key);
+    auto write_ticket = cache->make_ticket(key);
+    m.at("name").set_value("new");
+    cache->update(key, dbm::identity_cache::make_snapshot(m), write_ticket);
+
+    m.at("name").set_value("old");
+    BOOST_TEST(!cache->insert(key, dbm::identity_cache::make_snapshot(m), read_ticket));
+    BOOST_TEST(cache->find(key)->at(0).at("name").get<std::string>() == "new");
+    BOOST_TEST(cache->stat().rejected == 1);
+
+    // table invalidation
+    read_ticket = cache->make_ticket(key);
+    cache->invalidate("TEST_IDENTITY");
+    BOOST_TEST(!cache->find(key));
+    BOOST_TEST(!cache->insert(key, dbm::identity_cache::make_snapshot(m), read_ticket));
+}
+
+BOOST_AUTO_TEST_CASE(sqlite_pool_concurrent)
+{
+    remove_sqlite_files(db_file_name);
+
+    constexpr int n_records = 20;
+    constexpr int n_writes = 50;
+
+    dbm::sqlite_pool pool(db_file_name, 4);
+    auto cache = make_cache(1000, dbm::identity_cache::eviction_policy::fifo);
+    pool.set_identity_cache(cache);
+
+    {
+        auto conn = pool.acquire_writer();
+        get_model().create_table(conn.get());
+        for (int i = 1; i <= n_records; ++i) {
+            write(conn.get(), i, "r", 0);
+        }
+    }
+
+    std::atomic<bool> done {false};
+    std::atomic<int> errors {0};
+
+    std::thread writer([&] {
+        for (int v = 1; v <= n_writes; ++v) {
+            for (int i = 1; i <= n_records; ++i) {
+                auto m = get_model();
+                m.at("id").set_value(i);
+                m.at("name").set_value("r");
+                m.at("value").set_value(v);
+                pool.write_record(m);
+            }
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            std::vector<int> last(n_records + 1, 0);
+            while (!done) {
+                for (int i = 1; i <= n_records; ++i) {
+                    auto m = get_model();
+                    m.at("id").set_value(i);
+                    pool.read_record(m);
+                    // values never go back in time
+                    int v = m.at("value").value<int>();
+                    if (v < last[i])
+                        ++errors;
+                    last[i] = v;
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    BOOST_TEST(errors == 0);
+    BOOST_TEST(cache->stat().hits > 0);
+
+    for (int i = 1; i <= n_records; ++i) {
+        auto m = get_model();
+        m.at("id").set_value(i);
+        pool.read_record(m);
+        BOOST_TEST(m.at("value").value<int>() == n_writes);
+    }
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,145 @@
+#include <dbm/dbm.hpp>
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <thread>
+
+using namespace boost::unit_test;
+using namespace std::chrono_literals;
+
+BOOST_AUTO_TEST_SUITE(TstLatencyHistogram)
+
+BOOST_AUTO_TEST_CASE(bucket_bounds)
+{
+    using h = dbm::latency_histogram;
+
+    // small values have exact buckets
+    for (uint64_t v = 0; v < h::n_sub_buckets; ++v) {
+        BOOST_TEST(h::bucket_index(v) == v);
+    }
+
+    uint64_t prev_upper = 0;
+    for (size_t i = 0; i < h::n_buckets; ++i) {
+        auto lower = h::bucket_lower_bound(i);
+        auto upper = h::bucket_upper_bound(i);
+        // buckets are contiguous and every bound maps back to its bucket
+        BOOST_TEST(lower == prev_upper);
+        BOOST_TEST(h::bucket_index(lower) == i);
+        if (i + 1 < h::n_buckets) {
+            BOOST_TEST(h::bucket_index(upper - 1) == i);
+            // relative bucket width is at most 1 / n_sub_buckets
+            BOOST_TEST((upper - lower) * h::n_sub_buckets <= std::max<uint64_t>(lower, h::n_sub_buckets));
+        }
+        prev_upper = upper;
+    }
+
+    // out of range values go to the last bucket
+    BOOST_TEST(h::bucket_index(uint64_t(1) << 50) == h::n_buckets - 1);
+}
+
+BOOST_AUTO_TEST_CASE(record_snapshot)
+{
+    dbm::latency_histogram h;
+
+    BOOST_TEST(h.snap().count == 0);
+    BOOST_TEST(h.snap().percentile(0.5).count() == 0);
+
+    for (int i = 1; i <= 100; ++i) {
+        h.record(std::chrono::milliseconds(i));
+    }
+    h.record(-1ns);
+
+    auto s = h.snap();
+    BOOST_TEST(s.count == 101);
+    BOOST_TEST((s.max == 100ms));
+    BOOST_TEST((s.sum == 5050ms));
+    BOOST_TEST(s.buckets.front().first.count() == 1); // negative duration is recorded as 0
+
+    auto p50 = s.percentile(0.5);
+    auto p99 = s.percentile(0.99);
+    BOOST_TEST((p50 >= 50ms && p50 <= 57ms));
+    BOOST_TEST((p99 >= 99ms && p99 <= 100ms));
+    BOOST_TEST((s.percentile(1) == 100ms));
+
+    h.reset();
+    BOOST_TEST(h.snap().count == 0);
+    BOOST_TEST(h.snap().max.count() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_since)
+{
+    dbm::latency_histogram h;
+    h.record(1ms);
+    h.record(5ms);
+    auto prev = h.snap();
+
+    h.record(1ms);
+    h.record(2ms);
+    h.record(2ms);
+
+    auto s = h.snap().since(prev);
+    BOOST_TEST(s.count == 3);
+    BOOST_TEST((s.sum == 5ms));
+    BOOST_TEST(s.buckets.size() == 2);
+    BOOST_TEST((s.max >= 2ms && s.max < 3ms));
+    BOOST_TEST((s.percentile(0.5) >= 2ms && s.percentile(0.5) < 3ms));
+
+    // nothing recorded since
+    BOOST_TEST(h.snap().since(h.snap()).count == 0);
+
+    // histogram reset in between
+    h.reset();
+    h.record(1ms);
+    BOOST_TEST(h.snap().since(prev).count == 1);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_record)
+{
+    constexpr int n_threads = 4;
+    constexpr int n_records = 10000;
+
+    dbm::latency_histogram h;
+    std::vector<std::thread> thr;
+    for (int t = 0; t < n_threads; ++t) {
+        thr.emplace_back([&h, t] {
+            for (int i = 0; i < n_records; ++i) {
+                h.record(std::chrono::microseconds(t * n_records + i));
+            }
+        });
+    }
+    for (auto& it : thr) {
+        it.join();
+    }
+
+    auto s = h.snap();
+    BOOST_TEST(s.count == n_threads * n_records);
+    BOOST_TEST((s.max == std::chrono::microseconds(n_threads * n_records - 1)));
+}
+
+BOOST_AUTO_TEST_CASE(prometheus)
+{
+    dbm::latency_histogram h;
+    h.record(50us);
+    h.record(2ms);
+    h.record(2ms);
+    h.record(120s);
+
+    std::ostringstream os;
+    h.snap().write_prometheus(os, "test_seconds", "pool=\"main\"");
+    auto text = os.str();
+
+    BOOST_TEST(text.find("# TYPE test_seconds histogram\n") == 0);
+    BOOST_TEST(text.find("test_seconds_bucket{pool=\"main\",le=\"0.0001\"} 1\n") != std::string::npos);
+    BOOST_TEST(text.find("test_seconds_bucket{pool=\"main\",le=\"0.0025\"} 3\n") != std::string::npos);
+    BOOST_TEST(text.find("test_seconds_bucket{pool=\"main\",le=\"60\"} 3\n") != std::string::npos);
+    BOOST_TEST(text.find("test_seconds_bucket{pool=\"main\",le=\"+Inf\"} 4\n") != std::string::npos);
+    BOOST_TEST(text.find("test_seconds_sum{pool=\"main\"} 120.00405\n") != std::string::npos);
+    BOOST_TEST(text.find("test_seconds_count{pool=\"main\"} 4\n") != std::string::npos);
+
+    // no labels
+    os.str("");
+    h.snap().write_prometheus(os, "test_seconds");
+    BOOST_TEST(os.str().find("test_seconds_bucket{le=\"+Inf\"} 4\n") != std::string::npos);
+    BOOST_TEST(os.str().find("test_seconds_count 4\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -128,6 +128,64 @@ END;)");
     BOOST_TEST(rows.size() == 100);
 }
 
+BOOST_AUTO_TEST_CASE(procedure_multi_result)
+{
+    auto db = get_session();
+
+    db->query("DROP PROCEDURE IF EXISTS tst_mysql_procedure_multi");
+    db->query(R"(CREATE PROCEDURE tst_mysql_procedure_multi (p1 INT, p2 INT)
+BEGIN
+    SELECT * FROM tst_mysql_procedure WHERE id <= p1;
+    SELECT id FROM tst_mysql_procedure WHERE id > p1 AND id <= p2;
+END;)");
+
+    auto results = db->select_multi("CALL tst_mysql_procedure_multi(10, 30)");
+
+    // two result sets and the procedure status result
+    BOOST_TEST(results.size() == 3);
+    BOOST_TEST(results.at(0).has_result_set());
+    BOOST_TEST(results.at(0).rows.size() == 10);
+    BOOST_TEST(results.at(0).rows.field_names().size() == 3);
+    BOOST_TEST(results.at(1).has_result_set());
+    BOOST_TEST(results.at(1).rows.size() == 20);
+    BOOST_TEST(results.at(1).rows.field_names().size() == 1);
+    BOOST_TEST(results.at(1).rows.at(0).at("id").get<int>() == 11);
+    BOOST_TEST(!results.at(2).has_result_set());
+
+    // session is usable after multi statement query
+    BOOST_TEST(db->select("SELECT 1").size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(multi_statement_batch)
+{
+    auto db = get_session();
+
+    std::vector<uint64_t> affected;
+    std::vector<size_t> num_rows;
+
+    db->query_multi("UPDATE tst_mysql_procedure SET value1='multi' WHERE id <= 5;"
+                    "SELECT * FROM tst_mysql_procedure WHERE value1='multi';"
+                    "SELECT COUNT(*) FROM tst_mysql_procedure",
+                    [&](dbm::sql_result& res) {
+                        affected.push_back(res.affected_rows);
+                        num_rows.push_back(res.rows.size());
+                    });
+
+    BOOST_TEST(affected.size() == 3);
+    BOOST_TEST(affected.at(0) == 5);
+    BOOST_TEST(num_rows.at(0) == 0);
+    BOOST_TEST(num_rows.at(1) == 5);
+    BOOST_TEST(num_rows.at(2) == 1);
+
+    // error in the second statement
+    BOOST_REQUIRE_THROW(db->select_multi("SELECT 1; SELECT * FROM no_such_table_xyz; SELECT 2"), std::exception);
+    BOOST_TEST(db->select("SELECT 1").size() == 1);
+
+    // multi statements are disabled again after the call
+    BOOST_REQUIRE_THROW(db->query("SELECT 1; SELECT 2"), std::exception);
+    BOOST_TEST(db->select("SELECT 1").size() == 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif
\ No newline at end of file
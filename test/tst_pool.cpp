@@ -192,6 +192,28 @@ BOOST_AUTO_TEST_CASE(pool_heartbeat_error)
     BOOST_TEST(pool.num_connections() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(pool_validate_on_acquire)
+{
+    MySqlPool pool;
+    setup_pool(pool);
+    pool.set_heartbeat_interval(0s);
+    pool.set_validation_interval(100ms);
+
+    auto conn = pool.acquire();
+    auto* db = &conn.get();
+    BOOST_TEST(db->ping());
+    conn.release();
+
+    std::this_thread::sleep_for(200ms);
+    db->close(); // manually close connection
+    BOOST_TEST(!db->ping());
+
+    // closed idle session is replaced by a new one
+    BOOST_TEST(pool.acquire().get().ping());
+    BOOST_TEST(pool.stat().n_validations_failed == 1);
+    BOOST_TEST(pool.num_connections() == 1);
+}
+
 BOOST_AUTO_TEST_CASE(pool_no_handover_if_connection_closed)
 {
     MySqlPool pool;
@@ -0,0 +1,330 @@
+#ifdef DBM_SQLITE3
+
+#include "dbm/dbm.hpp"
+#include "db_settings.h"
+#include "common.h"
+#include <dbm/drivers/sqlite/sqlite_session.hpp>
+#include <dbm/drivers/sqlite/sqlite_pool.hpp>
+#include <thread>
+
+using namespace boost::unit_test;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr const char* db_file_name = "dbm_test_cache.sqlite3";
+
+dbm::model get_model()
+{
+    return dbm::model("test_cache",
+                      {
+                          { dbm::key("id"), dbm::local<int>(), dbm::primary(true), dbm::not_null(true) },
+                          { dbm::key("name"), dbm::local<std::string>() }
+                      });
+}
+
+void insert(dbm::sqlite_session& db, int id, std::string const& name)
+{
+    auto m = get_model();
+    m.at("id").set_value(id);
+    m.at("name").set_value(name);
+    m.write_record(db);
+}
+
+std::shared_ptr<dbm::query_cache> make_cache(std::chrono::milliseconds ttl = 10s, size_t max_bytes = 1024 * 1024)
+{
+    dbm::query_cache::config cfg;
+    cfg.ttl = ttl;
+    cfg.max_bytes = max_bytes;
+    return std::make_shared<dbm::query_cache>(cfg);
+}
+
+void init_db(dbm::sqlite_session& db)
+{
+    remove_sqlite_files(db_file_name);
+    db.connect(db_file_name);
+    auto m = get_model();
+    m.create_table(db);
+    insert(db, 1, "a");
+    insert(db, 2, "b");
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TstQueryCache)
+
+BOOST_AUTO_TEST_CASE(statement_info)
+{
+    auto i = dbm::detail::parse_statement_info("SELECT a.x, b.y FROM `db`.`Table_A` a JOIN tb b ON a.id = b.id, tc WHERE a.x = 'from td'");
+    BOOST_TEST(i.cacheable);
+    BOOST_TEST(i.read_tables == (std::vector<std::string> {"`db`.`Table_A`", "tb", "tc"}));
+    BOOST_TEST(i.write_tables.empty());
+
+    i = dbm::detail::parse_statement_info("SELECT * FROM (SELECT id FROM ta) t JOIN tb USING (id)");
+    BOOST_TEST(i.read_tables == (std::vector<std::string> {"ta", "tb"}));
+
+    i = dbm::detail::parse_statement_info("SELECT * FROM ta FOR UPDATE");
+    BOOST_TEST(!i.cacheable);
+
+    i = dbm::detail::parse_statement_info("INSERT OR REPLACE INTO ta (id) VALUES (1)");
+    BOOST_TEST(!i.cacheable);
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"ta"}));
+
+    i = dbm::detail::parse_statement_info("/* c */ update tb set x = 1; delete from tc -- comment");
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"tb", "tc"}));
+    BOOST_TEST(!i.invalidate_all);
+
+    // no tables, non-deterministic and session dependent values
+    for (auto const* stmt : {"SELECT 1", "SELECT LAST_INSERT_ID()", "SELECT last_insert_rowid()", "SELECT @@version",
+                             "SELECT NOW() FROM ta", "SELECT * FROM ta ORDER BY RAND()", "SELECT @v := x FROM ta",
+                             "SELECT CURRENT_TIMESTAMP FROM ta", "SELECT * FROM ta LOCK IN SHARE MODE"}) {
+        BOOST_TEST(!dbm::detail::parse_statement_info(stmt).cacheable, stmt);
+    }
+    // function names used as identifiers
+    BOOST_TEST(dbm::detail::parse_statement_info("SELECT date, user FROM ta").cacheable);
+
+    // WITH statements are classified by their main statement
+    i = dbm::detail::parse_statement_info("WITH x (id) AS (SELECT id FROM ta), y AS (SELECT 1) SELECT * FROM x");
+    BOOST_TEST(i.cacheable);
+    BOOST_TEST(i.read_tables == (std::vector<std::string> {"ta", "x"}));
+    i = dbm::detail::parse_statement_info("WITH RECURSIVE x AS (SELECT id FROM ta) DELETE FROM tb WHERE id IN (SELECT id FROM x)");
+    BOOST_TEST(!i.cacheable);
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"tb"}));
+    i = dbm::detail::parse_statement_info("WITH x AS (SELECT 1) UPDATE tc SET a = 1");
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"tc"}));
+
+    BOOST_TEST(dbm::detail::parse_statement_info("DROP TABLE IF EXISTS td").write_tables == (std::vector<std::string> {"td"}));
+
+    // multi table writes invalidate every listed or joined table
+    i = dbm::detail::parse_statement_info("UPDATE ta JOIN tb ON ta.id = tb.id SET tb.x = 1 WHERE ta.y IN (SELECT y FROM tc)");
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"ta", "tb"}));
+    i = dbm::detail::parse_statement_info("UPDATE ta a, tb b SET b.x = a.x WHERE a.id = b.id");
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"ta", "tb"}));
+    i = dbm::detail::parse_statement_info("DELETE ta, tb FROM ta JOIN tb ON ta.id = tb.id LEFT JOIN tc USING (id) WHERE ta.x = 1");
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"ta", "tb", "tc"}));
+    i = dbm::detail::parse_statement_info("DELETE FROM ta USING ta, tb WHERE ta.id = tb.id");
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"ta", "tb"}));
+    i = dbm::detail::parse_statement_info("DROP TABLE IF EXISTS ta, tb");
+    BOOST_TEST(i.write_tables == (std::vector<std::string> {"ta", "tb"}));
+    BOOST_TEST(!i.invalidate_all);
+    BOOST_TEST(dbm::detail::parse_statement_info("CALL proc()").invalidate_all);
+    BOOST_TEST(dbm::detail::parse_statement_info("BEGIN").begin_transaction);
+    BOOST_TEST(dbm::detail::parse_statement_info("START TRANSACTION").begin_transaction);
+    BOOST_TEST(dbm::detail::parse_statement_info("COMMIT").end_transaction);
+    BOOST_TEST(!dbm::detail::parse_statement_info("ROLLBACK TO sp").end_transaction);
+}
+
+BOOST_AUTO_TEST_CASE(hit_miss)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    auto cache = make_cache();
+    db.set_query_cache(cache);
+
+    auto rows = db.select("SELECT name FROM test_cache ORDER BY id");
+    BOOST_TEST(rows.size() == 2);
+    BOOST_TEST(cache->stat().misses == 1);
+    BOOST_TEST(cache->stat().entries == 1);
+
+    rows = db.select("SELECT name FROM test_cache ORDER BY id");
+    BOOST_TEST(rows.size() == 2);
+    BOOST_TEST(rows.at(1).at("name").get<std::string>() == "b");
+    BOOST_TEST(cache->stat().hits == 1);
+
+    // hit is served from the cache - write bypassing the session is not visible
+    dbm::sqlite_session other;
+    other.connect(db_file_name);
+    other.query("DELETE FROM test_cache WHERE id = 2");
+    BOOST_TEST(db.select("SELECT name FROM test_cache ORDER BY id").size() == 2);
+
+    // prepared statements are keyed by statement and parameters
+    dbm::prepared_stmt stmt("SELECT name FROM test_cache WHERE id = 1", dbm::local<std::string>());
+    BOOST_TEST(db.select(stmt).size() == 1);
+    auto res = db.select(stmt);
+    BOOST_TEST(res.size() == 1);
+    BOOST_TEST(res[0][0]->get<std::string>() == "a");
+    BOOST_TEST(cache->stat().hits == 3);
+
+    // not cached (nor counted as a miss)
+    auto misses = cache->stat().misses;
+    db.select("PRAGMA journal_mode");
+    BOOST_TEST(cache->stat().entries == 2);
+    BOOST_TEST(cache->stat().misses == misses);
+
+    db.set_query_cache(nullptr);
+    BOOST_TEST(db.select("SELECT name FROM test_cache ORDER BY id").size() == 1);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(invalidation)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    auto cache = make_cache();
+    db.set_query_cache(cache);
+
+    auto count = [&] { return db.select("SELECT COUNT(*) FROM test_cache").at(0).at(0).get<int>(); };
+    db.select("SELECT 1");
+
+    BOOST_TEST(count() == 2);
+    BOOST_TEST(count() == 2);
+    BOOST_TEST(cache->stat().hits == 1);
+
+    // model write
+    insert(db, 3, "c");
+    BOOST_TEST(cache->stat().invalidations == 1);
+    BOOST_TEST(count() == 3);
+
+    // model delete
+    auto m = get_model();
+    m.at("id").set_value(3);
+    m.delete_record(db);
+    BOOST_TEST(count() == 2);
+
+    // model read sees the latest write
+    m.at("id").set_value(1);
+    m.read_record(db);
+    BOOST_TEST(m.at("name").value<std::string>() == "a");
+    m.at("name").set_value("aa");
+    m.write_record(db);
+    m.at("name").set_value("");
+    m.read_record(db);
+    BOOST_TEST(m.at("name").value<std::string>() == "aa");
+
+    // query
+    db.query("DELETE FROM test_cache WHERE id = 2");
+    BOOST_TEST(count() == 1);
+
+    // unrelated table does not invalidate
+    db.query("CREATE TABLE test_cache_other (id INTEGER)");
+    db.query("INSERT INTO test_cache_other VALUES (1)");
+    auto hits = cache->stat().hits;
+    BOOST_TEST(count() == 1);
+    BOOST_TEST(cache->stat().hits == hits + 1);
+
+    // "SELECT 1" reads no tables and is not cached
+    db.query("DELETE FROM test_cache");
+    BOOST_TEST(count() == 0);
+    BOOST_TEST(db.select("SELECT 1").size() == 1);
+    BOOST_TEST(cache->stat().hits == hits + 1);
+
+    // writes of a WITH statement invalidate
+    insert(db, 4, "d");
+    BOOST_TEST(count() == 1);
+    BOOST_TEST(count() == 1);
+    db.query("WITH ids AS (SELECT 4 AS id) DELETE FROM test_cache WHERE id IN (SELECT id FROM ids)");
+    BOOST_TEST(count() == 0);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(transaction)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    auto cache = make_cache();
+    db.set_query_cache(cache);
+
+    auto count = [&] { return db.select("SELECT COUNT(*) FROM test_cache").at(0).at(0).get<int>(); };
+
+    BOOST_TEST(count() == 2);
+    {
+        dbm::sqlite_session::transaction tr(db);
+        insert(db, 3, "c");
+
+        // selects inside the transaction bypass the cache
+        auto stat = cache->stat();
+        BOOST_TEST(count() == 3);
+        BOOST_TEST(count() == 3);
+        BOOST_TEST(cache->stat().hits == stat.hits);
+        BOOST_TEST(cache->stat().entries == 0);
+        tr.rollback();
+    }
+
+    BOOST_TEST(count() == 2);
+    BOOST_TEST(count() == 2);
+    BOOST_TEST(cache->stat().hits == 1);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(ttl_and_size)
+{
+    dbm::sqlite_session db;
+    init_db(db);
+
+    auto cache = make_cache(100ms);
+    db.set_query_cache(cache);
+
+    db.select("SELECT * FROM test_cache");
+    db.select("SELECT * FROM test_cache");
+    BOOST_TEST(cache->stat().hits == 1);
+
+    std::this_thread::sleep_for(150ms);
+    db.select("SELECT * FROM test_cache");
+    BOOST_TEST(cache->stat().hits == 1);
+    BOOST_TEST(cache->stat().expirations == 1);
+    BOOST_TEST(cache->stat().entries == 1);
+
+    // size budget - least recently used entries are evicted
+    auto cfg = cache->get_config();
+    cfg.ttl = 10s;
+    cfg.max_bytes = cache->stat().bytes * 2;
+    cache->set_config(cfg);
+    cache->clear();
+    cache->reset_stat();
+
+    db.select("SELECT * FROM test_cache WHERE id = 1");
+    db.select("SELECT * FROM test_cache WHERE id = 2");
+    db.select("SELECT * FROM test_cache WHERE id = 1");
+    db.select("SELECT * FROM test_cache WHERE id > 0");
+    BOOST_TEST(cache->stat().evictions >= 1);
+    BOOST_TEST(cache->stat().bytes <= cfg.max_bytes);
+
+    // id = 1 was used more recently than id = 2
+    auto hits = cache->stat().hits;
+    db.select("SELECT * FROM test_cache WHERE id = 1");
+    BOOST_TEST(cache->stat().hits == hits + 1);
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(sqlite_pool_shared_cache)
+{
+    remove_sqlite_files(db_file_name);
+
+    dbm::sqlite_pool pool(db_file_name, 2);
+    auto cache = make_cache();
+    pool.set_query_cache(cache);
+    BOOST_TEST(pool.get_query_cache() == cache);
+
+    pool.query("CREATE TABLE test_cache (id INTEGER PRIMARY KEY, name TEXT)");
+    pool.query("INSERT INTO test_cache (id, name) VALUES (1, 'a')");
+
+    auto count = [&] { return pool.select("SELECT COUNT(*) FROM test_cache").at(0).at(0).get<int>(); };
+    BOOST_TEST(count() == 1);
+    BOOST_TEST(count() == 1);
+    BOOST_TEST(cache->stat().hits == 1);
+
+    // write on the writer connection invalidates results cached by readers
+    auto m = get_model();
+    m.at("id").set_value(2);
+    m.at("name").set_value("b");
+    pool.write_record(m);
+    BOOST_TEST(count() == 2);
+
+    // rows restored from the cache outlive the cache entry
+    auto rows = pool.select("SELECT name FROM test_cache ORDER BY id");
+    cache->clear();
+    BOOST_TEST(rows.at(1).at(0).get<std::string>() == "b");
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -1,5 +1,7 @@
 #include <dbm/dbm.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
 #include <iomanip>
 
 using namespace boost::unit_test;
@@ -135,7 +137,6 @@ BOOST_AUTO_TEST_CASE(sql_rows_copy)
 
     for (const auto& R : data) {
         auto& row = rows.emplace_back();
-        row.set_fields(&rows.field_names(), &rows.field_map());
         for (auto const& it : R) {
             row.emplace_back(it, it ? strlen(it) : 0);
         }
@@ -196,4 +197,349 @@ BOOST_AUTO_TEST_CASE(sql_rows_copy)
     validate_rows(rows_from_dump);
 }
 
+BOOST_AUTO_TEST_CASE(sql_rows_flat)
+{
+    std::vector<std::string> values;
+    for (int i = 0; i < 30; ++i) {
+        values.push_back(std::to_string(i));
+    }
+
+    dbm::sql_rows rows;
+    rows.set_field_names({"a", "b", "c"});
+    for (int i = 0; i < 10; ++i) {
+        auto& row = rows.emplace_back();
+        for (int j = 0; j < 3; ++j) {
+            row.emplace_back(values[i * 3 + j].c_str(), values[i * 3 + j].size());
+        }
+    }
+
+    BOOST_TEST(rows.size() == 10);
+    BOOST_TEST(rows.num_values() == 30);
+
+    // rows are contiguous views into a single value array
+    BOOST_TEST(rows[1].data() == rows[0].data() + 3);
+    BOOST_TEST(rows[9].back().get() == "29");
+
+    // values can only be appended to the last row
+    BOOST_REQUIRE_THROW(rows[0].emplace_back(nullptr, 0), std::domain_error);
+    dbm::kind::sql_row standalone;
+    BOOST_REQUIRE_THROW(standalone.emplace_back(nullptr, 0), std::domain_error);
+    BOOST_REQUIRE_THROW(rows[0].at(3), std::out_of_range);
+    BOOST_REQUIRE_THROW(rows.at(10), std::out_of_range);
+
+    // move does not touch rows - views remain valid
+    auto const* row_addr = &rows[5];
+    auto const* names_addr = &rows.field_names();
+    dbm::sql_rows moved = std::move(rows);
+    BOOST_TEST(rows.empty());
+    BOOST_TEST(&moved[5] == row_addr);
+    BOOST_TEST(moved[5].field_names() == names_addr);
+    BOOST_TEST(moved[5].at("b").get() == "16");
+
+    size_t n = 0;
+    for (auto it = moved.rbegin(); it != moved.rend(); ++it) {
+        for (auto const& v : *it) {
+            n += v.get<int>();
+        }
+    }
+    BOOST_TEST(n == 435);
+
+    moved.pop_back();
+    BOOST_TEST(moved.size() == 9);
+    BOOST_TEST(moved.num_values() == 27);
+    moved.back().emplace_back(nullptr, 0);
+    BOOST_TEST(moved.back().size() == 4);
+    BOOST_TEST(moved.back().back().null());
+
+    moved.clear();
+    BOOST_TEST(moved.empty());
+    BOOST_TEST(moved.field_names().size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(sql_rows_column_handle)
+{
+    std::vector<std::string> values {"1", "ivo", "13", "2", "tarzan", "42"};
+
+    dbm::sql_rows rows;
+    rows.set_field_names({"id", "name", "score"});
+    for (int i = 0; i < 2; ++i) {
+        auto& row = rows.emplace_back();
+        for (int j = 0; j < 3; ++j) {
+            row.emplace_back(values[i * 3 + j].c_str(), values[i * 3 + j].size());
+        }
+    }
+
+    // interned ids are shared by equal names
+    dbm::kind::column_id name_id("name");
+    BOOST_TEST((name_id == dbm::kind::column_id(std::string("na") + "me")));
+    BOOST_TEST((name_id != dbm::kind::column_id("score")));
+    BOOST_TEST(name_id.name() == "name");
+    BOOST_TEST((rows.field_ids().at(1) == name_id));
+    BOOST_TEST(!dbm::kind::column_id().valid());
+
+    auto score = rows.column("score");
+    BOOST_TEST(score.index() == 2);
+    BOOST_TEST((score.id() == dbm::kind::column_id("score")));
+    BOOST_TEST(rows[0][score].get<int>() == 13);
+    BOOST_TEST(rows[1].at(score).get<int>() == 42);
+    BOOST_TEST(rows.column(name_id).index() == 1);
+    BOOST_TEST(rows[1].at(name_id).get() == "tarzan");
+    BOOST_TEST(rows.column_index(dbm::kind::column_id("unknown")) == -1);
+    BOOST_REQUIRE_THROW(rows.column("unknown"), std::out_of_range);
+    BOOST_REQUIRE_THROW(rows[0].at(dbm::kind::column_id("unknown")), std::out_of_range);
+
+    // field names are looked up, not interned
+    dbm::sql_rows plain;
+    plain.set_field_names({"tst_column_id_plain", "tst_column_id_late"});
+    BOOST_TEST(!plain.field_ids().at(0).valid());
+    BOOST_TEST(plain.column_index(name_id) == -1);
+
+    // name interned after the id table was built
+    dbm::kind::column_id late("tst_column_id_late");
+    BOOST_TEST(plain.column_index(late) == 1);
+    BOOST_TEST(plain.column("tst_column_id_late").index() == 1);
+
+    // model keys use the same ids
+    dbm::model m("test",
+                 {
+                     { dbm::key("id"), dbm::local<int>() },
+                     { dbm::key("score"), dbm::local<int>() },
+                     { dbm::key("other"), dbm::local<int>() }
+                 });
+    BOOST_TEST((m.at("score").key_id() == score.id()));
+
+    m << rows[1];
+    BOOST_TEST(m.at("id").value<int>() == 2);
+    BOOST_TEST(m.at("score").value<int>() == 42);
+    BOOST_TEST(m.at("other").is_null());
+}
+
+BOOST_AUTO_TEST_CASE(sql_rows_column_as)
+{
+    std::vector<const char*> ints {"1", " 2", "+3", nullptr, "-5", "600000000000"};
+    std::vector<const char*> doubles {"1.5", "-2.25", "1e3", nullptr, "0", "3"};
+
+    dbm::sql_rows rows;
+    rows.set_field_names({"i", "d", "s"});
+    for (size_t i = 0; i < ints.size(); ++i) {
+        auto& row = rows.emplace_back();
+        row.emplace_back(ints[i], ints[i] ? strlen(ints[i]) : 0);
+        row.emplace_back(doubles[i], doubles[i] ? strlen(doubles[i]) : 0);
+        row.emplace_back("x", 1);
+    }
+
+    auto i64 = rows.column_as<int64_t>(0);
+    BOOST_TEST((i64.values == std::vector<int64_t> {1, 2, 3, 0, -5, 600000000000}));
+    BOOST_TEST((i64.nulls == std::vector<uint8_t> {0, 0, 0, 1, 0, 0}));
+    BOOST_TEST(i64.null_count == 1);
+
+    auto d = rows.column_as<double>("d");
+    BOOST_TEST((d.values == std::vector<double> {1.5, -2.25, 1000, 0, 0, 3}));
+    BOOST_TEST(d.null_count == 1);
+
+    // same results as per value conversion
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!d.nulls[i]) {
+            BOOST_TEST(d.values[i] == rows[i].at("d").get<double>());
+        }
+    }
+
+    auto s = rows.column_as<std::string>(rows.column("s"));
+    BOOST_TEST(s.values.at(5) == "x");
+    BOOST_TEST(s.null_count == 0);
+
+    // conversion errors
+    BOOST_REQUIRE_THROW(rows.column_as<int32_t>(0), std::domain_error); // out of range
+    BOOST_REQUIRE_THROW(rows.column_as<int>(1), std::domain_error);     // not an integer
+    BOOST_REQUIRE_THROW(rows.column_as<double>(2), std::domain_error);
+    BOOST_REQUIRE_THROW(rows.column_as<int>(3), std::out_of_range);
+    BOOST_TEST(dbm::sql_rows().column_as<int>(0).values.empty());
+}
+
+BOOST_AUTO_TEST_CASE(sql_rows_dump_arena)
+{
+    dbm::sql_rows rows;
+    rows.set_field_names({"id", "name"});
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 100; ++i) {
+        names.push_back(i % 3 ? "name_" + std::to_string(i) : "");
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        auto& row = rows.emplace_back();
+        row.emplace_back(names[i].c_str(), names[i].size());
+        row.emplace_back(i % 5 ? names[i].c_str() : nullptr, i % 5 ? names[i].size() : 0);
+    }
+
+    dbm::sql_rows_dump dump(rows);
+    BOOST_TEST(dump.size() == 100);
+    BOOST_TEST(dump.num_values() == 200);
+
+    // append twice - second batch is a copy of the first
+    dump += rows;
+    BOOST_TEST(dump.size() == 200);
+    BOOST_TEST(dump.num_values() == 400);
+
+    dbm::sql_rows restored;
+    {
+        dbm::sql_rows_dump tmp(dump);
+        restored = tmp.restore();
+    }
+
+    // restored rows share the arena and outlive the dump
+    BOOST_REQUIRE(restored.size() == 200);
+    for (size_t i = 0; i < 200; ++i) {
+        size_t src = i % 100;
+        BOOST_TEST(restored[i].at("id").get() == names[src]);
+        BOOST_TEST(restored[i].at("name").null() == (src % 5 == 0));
+        if (src % 5) {
+            BOOST_TEST(restored[i].at("name").get() == names[src]);
+        }
+    }
+
+    // appending after restore does not invalidate restored values (copy on write)
+    auto restored2 = dump.restore();
+    auto const* p = restored2[1].at("id").get().data();
+    for (int i = 0; i < 10; ++i) {
+        dump += rows;
+    }
+    BOOST_TEST(dump.size() == 1200);
+    BOOST_TEST(restored2[1].at("id").get().data() == p);
+    BOOST_TEST(restored2[1].at("id").get() == names[1]);
+
+    dump.clear();
+    BOOST_TEST(dump.empty());
+    BOOST_TEST(dump.restore().empty());
+}
+
+BOOST_AUTO_TEST_CASE(sql_rows_dump_file)
+{
+    static constexpr const char* file_name = "dbm_test_rows.dump";
+
+    dbm::sql_rows rows;
+    rows.set_field_names({"id", "name", "note"});
+
+    std::vector<std::string> values;
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(std::to_string(i));
+        values.push_back("name_" + std::to_string(i));
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        auto& row = rows.emplace_back();
+        row.emplace_back(values[i * 2].c_str(), values[i * 2].size());
+        row.emplace_back(values[i * 2 + 1].c_str(), values[i * 2 + 1].size());
+        row.emplace_back(nullptr, 0);
+    }
+
+    dbm::sql_rows_dump(rows).save(file_name);
+
+    dbm::sql_rows restored;
+    {
+        dbm::sql_rows_dump dump;
+        dump.load_mmap(file_name);
+        BOOST_TEST(dump.is_mapped());
+        BOOST_TEST(dump.size() == 1000);
+        BOOST_TEST(dump.num_values() == 3000);
+        BOOST_TEST((dump.field_names() == dbm::kind::sql_fields {"id", "name", "note"}));
+        BOOST_TEST(dump.field_map().at("note") == 2);
+        restored = dump.restore();
+
+        // appending copies mapped data to memory
+        dump += rows;
+        BOOST_TEST(!dump.is_mapped());
+        BOOST_TEST(dump.size() == 2000);
+        BOOST_TEST(dump.restore().at(1999).at("name").get() == "name_999");
+    }
+
+    // restored rows keep the mapping alive
+    BOOST_REQUIRE(restored.size() == 1000);
+    for (int i = 0; i < 1000; ++i) {
+        BOOST_TEST(restored[i].at("id").get<int>() == i);
+        BOOST_TEST(restored[i].at("name").get() == values[i * 2 + 1]);
+        BOOST_TEST(restored[i].at("note").null());
+    }
+
+    // empty dump round trip
+    dbm::sql_rows_dump().save(file_name);
+    dbm::sql_rows_dump empty_dump;
+    empty_dump.load_mmap(file_name);
+    BOOST_TEST(empty_dump.empty());
+    BOOST_TEST(empty_dump.field_names().empty());
+
+    // invalid file
+    {
+        std::ofstream f(file_name, std::ios::binary | std::ios::trunc);
+        f << "not a rows dump file, just some text long enough for the header........";
+    }
+    BOOST_REQUIRE_THROW(empty_dump.load_mmap(file_name), std::exception);
+    BOOST_REQUIRE_THROW(empty_dump.load_mmap("dbm_test_no_such_file.dump"), std::exception);
+
+    std::remove(file_name);
+}
+
+BOOST_AUTO_TEST_CASE(sql_rows_dump_corrupt_file)
+{
+    static constexpr const char* file_name = "dbm_test_rows_corrupt.dump";
+
+    dbm::sql_rows rows;
+    rows.set_field_names({"id", "name"});
+    for (auto const* v : {"1", "a", "2", "bb"}) {
+        if (rows.empty() || rows.back().size() == 2)
+            rows.emplace_back();
+        rows.back().emplace_back(v, strlen(v));
+    }
+    dbm::sql_rows_dump(rows).save(file_name);
+
+    std::string content;
+    {
+        std::ifstream f(file_name, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+
+    // header (64 bytes), names section (2 x 8 byte length + 1 char, padded to 24 bytes),
+    // offsets (5), row indexes (3), null bitmap (1) and 9 data bytes
+    BOOST_REQUIRE(content.size() == 64 + 24 + 9 * 8 + 9);
+    size_t const offsets_pos = 64 + 24;
+    size_t const rows_pos = offsets_pos + 5 * 8;
+    size_t const data_pos = rows_pos + 4 * 8;
+
+    auto load = [&](std::string const& data) {
+        {
+            std::ofstream f(file_name, std::ios::binary | std::ios::trunc);
+            f.write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+        dbm::sql_rows_dump dump;
+        dump.load_mmap(file_name);
+        return dump.restore().size();
+    };
+
+    auto with_u64 = [&](size_t pos, uint64_t value) {
+        auto data = content;
+        std::memcpy(&data[pos], &value, sizeof(value));
+        return data;
+    };
+
+    BOOST_TEST(load(content) == 2);
+
+    // value offset past the data section, non-monotonic offsets, row index past cells
+    BOOST_REQUIRE_THROW(load(with_u64(offsets_pos + 2 * 8, 1000)), std::runtime_error);
+    BOOST_REQUIRE_THROW(load(with_u64(offsets_pos + 2 * 8, 1)), std::runtime_error);
+    BOOST_REQUIRE_THROW(load(with_u64(offsets_pos + 1 * 8, 4)), std::runtime_error);
+    BOOST_REQUIRE_THROW(load(with_u64(rows_pos + 1 * 8, 100)), std::runtime_error);
+    BOOST_REQUIRE_THROW(load(with_u64(rows_pos + 2 * 8, 1)), std::runtime_error);
+
+    // missing terminator of the last value (the other ones are not checked when loading)
+    auto data = content;
+    data[data_pos + 8] = 'x';
+    BOOST_REQUIRE_THROW(load(data), std::runtime_error);
+
+    // truncated file
+    BOOST_REQUIRE_THROW(load(content.substr(0, content.size() - 8)), std::runtime_error);
+    BOOST_REQUIRE_THROW(load(content.substr(0, 40)), std::runtime_error);
+
+    std::remove(file_name);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
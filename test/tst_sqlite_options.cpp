@@ -0,0 +1,120 @@
+#ifdef DBM_SQLITE3
+
+#include "dbm/dbm.hpp"
+#include "db_settings.h"
+#include "common.h"
+#include <dbm/drivers/sqlite/sqlite_session.hpp>
+
+using namespace boost::unit_test;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr const char* db_file_name = "dbm_test_options.sqlite3";
+
+std::string pragma(dbm::sqlite_session& db, std::string const& name)
+{
+    return std::string(db.select("PRAGMA " + name).at(0).at(0).get());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TstSQLiteOptions)
+
+BOOST_AUTO_TEST_CASE(default_options)
+{
+    remove_sqlite_files(db_file_name);
+
+    dbm::sqlite_session db;
+    db.connect(db_file_name, {});
+    BOOST_TEST(db.is_connected());
+    BOOST_TEST(pragma(db, "journal_mode") == "delete");
+    BOOST_TEST(pragma(db, "synchronous") == "2"); // FULL
+}
+
+BOOST_AUTO_TEST_CASE(presets)
+{
+    remove_sqlite_files(db_file_name);
+
+    {
+        dbm::sqlite_session db;
+        db.connect(db_file_name, dbm::sqlite_options::read_heavy());
+        BOOST_TEST(pragma(db, "journal_mode") == "wal");
+        BOOST_TEST(pragma(db, "synchronous") == "1"); // NORMAL
+        BOOST_TEST(pragma(db, "cache_size") == "-65536");
+        BOOST_TEST(pragma(db, "temp_store") == "2"); // MEMORY
+        BOOST_TEST(pragma(db, "busy_timeout") == "5000");
+    }
+
+    {
+        dbm::sqlite_session db;
+        db.connect(db_file_name, dbm::sqlite_options::bulk_load());
+        BOOST_TEST(pragma(db, "journal_mode") == "memory");
+        BOOST_TEST(pragma(db, "synchronous") == "0"); // OFF
+    }
+
+    {
+        dbm::sqlite_session db;
+        db.connect(db_file_name, dbm::sqlite_options::durable());
+        BOOST_TEST(pragma(db, "journal_mode") == "wal");
+        BOOST_TEST(pragma(db, "synchronous") == "2"); // FULL
+    }
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(read_only)
+{
+    remove_sqlite_files(db_file_name);
+
+    {
+        dbm::sqlite_session db;
+        db.connect(db_file_name);
+        db.query("CREATE TABLE t (id INTEGER)");
+    }
+
+    dbm::sqlite_options opts;
+    opts.read_only = true;
+
+    dbm::sqlite_session db;
+    db.connect(db_file_name, opts);
+    BOOST_TEST(db.select("SELECT COUNT(*) FROM t").size() == 1);
+    BOOST_REQUIRE_THROW(db.query("INSERT INTO t VALUES (1)"), std::exception);
+
+    // read only connection does not create a database
+    remove_sqlite_files(db_file_name);
+    dbm::sqlite_session db2;
+    BOOST_REQUIRE_THROW(db2.connect(db_file_name, opts), std::exception);
+    BOOST_TEST(!db2.is_connected());
+}
+
+BOOST_AUTO_TEST_CASE(busy_handler)
+{
+    remove_sqlite_files(db_file_name);
+
+    dbm::sqlite_session writer;
+    writer.connect(db_file_name);
+    writer.query("CREATE TABLE t (id INTEGER)");
+    writer.query("BEGIN EXCLUSIVE");
+
+    int calls = 0;
+    dbm::sqlite_options opts;
+    opts.busy_handler = [&calls](int count) {
+        calls = count + 1;
+        return count < 2;
+    };
+
+    dbm::sqlite_session db;
+    db.connect(db_file_name, opts);
+    BOOST_REQUIRE_THROW(db.query("INSERT INTO t VALUES (1)"), std::exception);
+    BOOST_TEST(calls == 3);
+
+    writer.query("COMMIT");
+    db.query("INSERT INTO t VALUES (1)");
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
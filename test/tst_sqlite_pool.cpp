@@ -4,6 +4,9 @@
 #include "db_settings.h"
 #include "common.h"
 #include <dbm/drivers/sqlite/sqlite_session.hpp>
+#include <dbm/drivers/sqlite/sqlite_pool.hpp>
+#include <future>
+#include <set>
 
 using namespace boost::unit_test;
 using namespace std::chrono_literals;
@@ -15,6 +18,26 @@ void setup_pool(SQLitePool& pool)
     pool.set_max_connections(1);
 }
 
+// Session initializer with injectable delay and failure of the next connect
+struct SlowSQLiteSession
+{
+    static inline std::atomic<int> delay_ms {0};
+    static inline std::atomic<int> latency_ms {0};  // delay of every connect
+    static inline std::atomic<bool> fail {false};
+    static inline std::atomic<bool> down {false};   // every connect fails
+
+    std::shared_ptr<dbm::sqlite_session> operator()()
+    {
+        if (int ms = delay_ms.exchange(0) + latency_ms)
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        if (fail.exchange(false) || down)
+            throw std::runtime_error("connect failed");
+        return MakeSQLiteSession()();
+    }
+};
+
+using SlowSQLitePool = dbm::pool<dbm::sqlite_session, SlowSQLiteSession>;
+
 } // namespace
 
 BOOST_AUTO_TEST_SUITE(TstSQLitePool)
@@ -69,6 +92,33 @@ BOOST_AUTO_TEST_CASE(pool_acquire_release)
     BOOST_TEST(pool.num_idle_connections() == 1);
 }
 
+BOOST_AUTO_TEST_CASE(pool_rows_outlive_connection)
+{
+    SQLitePool pool;
+    setup_pool(pool);
+
+    dbm::kind::sql_rows rows;
+    {
+        auto conn = pool.acquire();
+        rows = conn.get().select("SELECT 1 AS a, 'abc' AS b");
+
+        // the next query must not invalidate the previous result
+        auto rows2 = conn.get().select("SELECT 2");
+        BOOST_TEST(rows2.at(0).at(0).get<int>() == 2);
+    }
+
+    // connection is released, rows still own the result table
+    auto conn = pool.acquire();
+    conn.get().select("SELECT 3");
+
+    std::string b;
+    std::thread([&, r = std::move(rows)] {
+        BOOST_TEST(r.at(0).at("a").get<int>() == 1);
+        b = r.at(0).at("b").get<std::string>();
+    }).join();
+    BOOST_TEST(b == "abc");
+}
+
 BOOST_AUTO_TEST_CASE(pool_acquire_timeout_exception)
 {
     SQLitePool pool;
@@ -84,7 +134,8 @@ BOOST_AUTO_TEST_CASE(pool_acquire_timeout_exception)
 
         auto rows = conn1.get().select("SELECT 1");
         BOOST_TEST(rows.size() == 1);
-        std::this_thread::sleep_for(3s);
+        // held well beyond the acquire timeout (1s + 2s) of the main thread
+        std::this_thread::sleep_for(4s);
         rows.clear();
         rows = conn1.get().select("SELECT 1");
         BOOST_TEST(rows.size() == 1);
@@ -102,6 +153,916 @@ BOOST_AUTO_TEST_CASE(pool_acquire_timeout_exception)
     t1.join();
 }
 
+BOOST_AUTO_TEST_CASE(pool_concurrent_acquire_release)
+{
+    constexpr size_t n_threads = 16;
+    constexpr size_t n_acquires = 500;
+
+    SQLitePool pool;
+    pool.set_max_connections(4);
+    pool.set_acquire_timeout(20s);
+
+    std::mutex mtx;
+    std::set<dbm::sqlite_session*> in_use;
+    std::atomic<size_t> n_errors {0};
+
+    std::vector<std::thread> thr;
+    for (size_t i = 0; i < n_threads; ++i) {
+        thr.emplace_back([&] {
+            for (size_t n = 0; n < n_acquires; ++n) {
+                auto conn = pool.acquire();
+                auto* s = &conn.get();
+
+                // session is never given to two acquirers at the same time
+                {
+                    std::lock_guard lock(mtx);
+                    if (!in_use.insert(s).second)
+                        ++n_errors;
+                }
+                std::this_thread::yield();
+                {
+                    std::lock_guard lock(mtx);
+                    in_use.erase(s);
+                }
+            }
+        });
+    }
+
+    for (auto& it : thr) {
+        it.join();
+    }
+
+    auto stat = pool.stat();
+    BOOST_TEST(n_errors == 0);
+    BOOST_TEST(stat.n_acquired == n_threads * n_acquires);
+    BOOST_TEST(stat.n_timeouts == 0);
+    BOOST_TEST(stat.n_acquiring == 0);
+    BOOST_TEST(stat.n_max_conn <= 4);
+    BOOST_TEST(pool.num_connections() <= 4);
+    BOOST_TEST(pool.num_active_connections() == 0);
+    BOOST_TEST(pool.num_idle_connections() == pool.num_connections());
+}
+
+BOOST_AUTO_TEST_CASE(pool_handover_order)
+{
+    constexpr size_t n_waiters = 4;
+
+    SQLitePool pool;
+    setup_pool(pool);
+    pool.set_acquire_timeout(20s);
+
+    auto conn = pool.acquire();
+
+    std::mutex mtx;
+    std::vector<size_t> order;
+    std::vector<std::thread> thr;
+
+    for (size_t i = 0; i < n_waiters; ++i) {
+        thr.emplace_back([&, i] {
+            auto c = pool.acquire();
+            std::lock_guard lock(mtx);
+            order.push_back(i);
+        });
+
+        // wait until the request is queued
+        while (pool.stat().n_acquiring != i + 1) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+
+    // the session is handed over to exactly one waiter at a time in acquire order
+    conn.release();
+
+    for (auto& it : thr) {
+        it.join();
+    }
+
+    BOOST_TEST(order == (std::vector<size_t> {0, 1, 2, 3}));
+    BOOST_TEST(pool.stat().n_acquiring == 0);
+    BOOST_TEST(pool.stat().n_acquired == n_waiters + 1);
+    BOOST_TEST(pool.num_idle_connections() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(pool_event_dispatcher)
+{
+    constexpr size_t n_threads = 4;
+    constexpr size_t n_acquires = 100;
+
+    SQLitePool pool;
+    pool.set_max_connections(2);
+
+    std::mutex mtx;
+    std::set<std::thread::id> dispatcher_ids;
+    std::atomic<size_t> n_acquired {0};
+
+    pool.set_event_callback([&](dbm::pool_event event, SQLitePool::id_t) {
+        if (event == dbm::pool_event::acquired)
+            ++n_acquired;
+        std::lock_guard lock(mtx);
+        dispatcher_ids.insert(std::this_thread::get_id());
+    });
+
+    std::vector<std::thread> thr;
+    for (size_t i = 0; i < n_threads; ++i) {
+        thr.emplace_back([&] {
+            for (size_t n = 0; n < n_acquires; ++n) {
+                auto conn = pool.acquire();
+            }
+        });
+    }
+
+    for (auto& it : thr) {
+        it.join();
+    }
+
+    for (int i = 0; i < 500 && n_acquired < n_threads * n_acquires; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+
+    // all events are delivered by a single dispatcher thread
+    BOOST_TEST(n_acquired == n_threads * n_acquires);
+    BOOST_TEST(dispatcher_ids.size() == 1);
+    BOOST_TEST((*dispatcher_ids.begin() != std::this_thread::get_id()));
+    BOOST_TEST(pool.stat().n_events_dispatched >= n_threads * n_acquires);
+    BOOST_TEST(pool.stat().n_events_dropped == 0);
+
+    // events are dropped while the queue is full
+    std::promise<void> unblock;
+    auto blocked = unblock.get_future().share();
+    pool.set_event_callback([blocked](dbm::pool_event, SQLitePool::id_t) {
+        blocked.wait();
+    });
+
+    for (size_t n = 0; n < SQLitePool::event_queue_size * 2; ++n) {
+        auto conn = pool.acquire();
+    }
+
+    BOOST_TEST(pool.stat().n_events_dropped > 0);
+    unblock.set_value();
+}
+
+BOOST_AUTO_TEST_CASE(pool_connect_outside_lock)
+{
+    SlowSQLitePool pool;
+    pool.set_max_connections(2);
+    pool.set_acquire_timeout(5s);
+
+    // slow connect does not block acquiring another connection
+    SlowSQLiteSession::delay_ms = 500;
+    auto slow = std::async(std::launch::async, [&] {
+        auto conn = pool.acquire();
+    });
+    std::this_thread::sleep_for(100ms);
+
+    auto tp = std::chrono::steady_clock::now();
+    {
+        auto conn = pool.acquire();
+        BOOST_TEST(pool.num_connections() == 2);
+    }
+    BOOST_TEST((std::chrono::steady_clock::now() - tp < 250ms));
+    slow.get();
+    BOOST_TEST(pool.num_connections() == 2);
+    BOOST_TEST(pool.num_idle_connections() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(pool_connect_failure)
+{
+    SlowSQLitePool pool;
+    pool.set_max_connections(1);
+    pool.set_acquire_timeout(5s);
+
+    // failed connect releases the slot
+    SlowSQLiteSession::fail = true;
+    BOOST_CHECK_THROW(pool.acquire(), std::runtime_error);
+    BOOST_TEST(pool.num_connections() == 0);
+    BOOST_TEST(pool.acquire().get().is_connected());
+
+    // slot of failed connect is handed over to the waiter
+    SlowSQLitePool pool2;
+    pool2.set_max_connections(1);
+    pool2.set_acquire_timeout(5s);
+
+    SlowSQLiteSession::delay_ms = 300;
+    SlowSQLiteSession::fail = true;
+    auto failed = std::async(std::launch::async, [&] {
+        auto conn = pool2.acquire();
+    });
+    std::this_thread::sleep_for(100ms);
+
+    auto tp = std::chrono::steady_clock::now();
+    {
+        auto conn = pool2.acquire();
+        BOOST_TEST(conn.get().is_connected());
+    }
+    BOOST_TEST((std::chrono::steady_clock::now() - tp < 1s));
+    BOOST_CHECK_THROW(failed.get(), std::runtime_error);
+    BOOST_TEST(pool2.num_connections() == 1);
+}
+
+template<typename Pool, typename Pred>
+bool wait_for(Pool const& pool, Pred pred, std::chrono::milliseconds timeout = 3s)
+{
+    auto until = std::chrono::steady_clock::now() + timeout;
+    while (!pred(pool)) {
+        if (std::chrono::steady_clock::now() > until)
+            return false;
+        std::this_thread::sleep_for(10ms);
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(pool_warm_up)
+{
+    SlowSQLitePool pool;
+    pool.set_max_connections(3);
+    pool.set_min_idle(4);
+
+    // connections are created in parallel up to max connections
+    SlowSQLiteSession::latency_ms = 200;
+    auto tp = std::chrono::steady_clock::now();
+    BOOST_TEST(pool.warm_up() == 3);
+    BOOST_TEST((std::chrono::steady_clock::now() - tp < 500ms));
+    SlowSQLiteSession::latency_ms = 0;
+
+    BOOST_TEST(pool.num_connections() == 3);
+    BOOST_TEST(pool.num_idle_connections() == 3);
+    BOOST_TEST(pool.warm_up() == 0);
+
+    // warmed up connections are reused
+    {
+        auto conn = pool.acquire();
+        BOOST_TEST(pool.num_connections() == 3);
+    }
+
+    // missing idle connections are created by the background thread
+    SlowSQLitePool pool2;
+    pool2.set_min_idle(2);
+    BOOST_TEST(wait_for(pool2, [](auto& p) { return p.num_idle_connections() == 2; }));
+    {
+        auto conn = pool2.acquire();
+        BOOST_TEST(wait_for(pool2, [](auto& p) { return p.num_idle_connections() == 2; }));
+        BOOST_TEST(pool2.num_connections() == 3);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pool_idle_timeout)
+{
+    SQLitePool pool;
+    pool.set_max_connections(4);
+    pool.set_heartbeat_interval(0s);
+
+    std::vector<dbm::sqlite_session*> sessions;
+    {
+        std::vector<SQLitePool::pool_connection_type> conns;
+        for (int i = 0; i < 4; ++i) {
+            conns.push_back(pool.acquire());
+            sessions.push_back(&conns.back().get());
+        }
+    }
+    BOOST_TEST(pool.num_idle_connections() == 4);
+
+    // the last released (most recently used) connection is kept
+    pool.set_min_idle(1);
+    pool.set_idle_timeout(100ms);
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.num_connections() == 1; }));
+    BOOST_TEST(pool.stat().n_closed_idle == 3);
+    BOOST_TEST(&pool.acquire().get() == sessions.back());
+
+    // idle connections are reused in LIFO order
+    pool.set_idle_timeout(0s);
+    pool.set_min_idle(0);
+    {
+        auto c1 = pool.acquire();
+        auto c2 = pool.acquire();
+        auto* s2 = &c2.get();
+        c2.release();
+        BOOST_TEST(&pool.acquire().get() == s2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pool_max_lifetime)
+{
+    SQLitePool pool;
+    pool.set_max_connections(2);
+    pool.set_max_lifetime(300ms);
+
+    // active connection is closed when released
+    {
+        auto conn = pool.acquire();
+        std::this_thread::sleep_for(400ms);
+    }
+    BOOST_TEST(pool.num_connections() == 0);
+    BOOST_TEST(pool.stat().n_closed_lifetime == 1);
+
+    // idle connection is closed by the background thread
+    pool.acquire();
+    BOOST_TEST(pool.num_idle_connections() == 1);
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.num_connections() == 0; }));
+    BOOST_TEST(pool.stat().n_closed_lifetime == 2);
+}
+
+BOOST_AUTO_TEST_CASE(session_ping)
+{
+    dbm::sqlite_session db;
+    BOOST_TEST(!db.ping());
+    db.connect(":memory:");
+    BOOST_TEST(db.ping());
+    db.close();
+    BOOST_TEST(!db.ping());
+}
+
+BOOST_AUTO_TEST_CASE(pool_validate_on_acquire)
+{
+    SQLitePool pool;
+    pool.set_max_connections(2);
+    pool.set_heartbeat_interval(0s);
+    pool.set_validation_interval(50ms);
+
+    auto conn = pool.acquire();
+    auto* db = &conn.get();
+    conn.release();
+
+    // recently used session is not validated
+    {
+        auto c = pool.acquire();
+        BOOST_TEST(&c.get() == db);
+    }
+    BOOST_TEST(pool.stat().n_validations == 0);
+
+    // idle session is validated, the broken one is replaced
+    std::this_thread::sleep_for(100ms);
+    db->close(); // manually close connection
+    {
+        auto c = pool.acquire();
+        BOOST_TEST(c.get().is_connected());
+    }
+    BOOST_TEST(pool.stat().n_validations == 1);
+    BOOST_TEST(pool.stat().n_validations_failed == 1);
+    BOOST_TEST(pool.num_connections() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(pool_heartbeat_ping)
+{
+    SQLitePool pool;
+    pool.set_max_connections(4);
+    pool.set_heartbeat_interval(200ms);
+
+    {
+        std::vector<SQLitePool::pool_connection_type> conns;
+        for (int i = 0; i < 4; ++i) {
+            conns.push_back(pool.acquire());
+        }
+        conns[0].get().query("DROP TABLE IF EXISTS test_pool_heartbeat");
+        conns[0].get().query("CREATE TABLE test_pool_heartbeat (id INTEGER)");
+    }
+
+    // all idle sessions are pinged
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.stat().n_heartbeats >= 4; }));
+    BOOST_TEST(pool.num_connections() == 4);
+
+    // custom heartbeat query
+    pool.set_heartbeat_query("SELECT COUNT(*) FROM test_pool_heartbeat");
+    pool.reset_heartbeats_counter();
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.stat().n_heartbeats >= 4; }));
+    BOOST_TEST(pool.num_connections() == 4);
+
+    // failed sessions are removed (the acquired one is not checked)
+    {
+        auto conn = pool.acquire();
+        conn.get().query("DROP TABLE test_pool_heartbeat");
+        BOOST_TEST(wait_for(pool, [](auto& p) { return p.num_connections() == 1; }));
+    }
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.num_connections() == 0; }));
+}
+
+BOOST_AUTO_TEST_CASE(pool_acquire_priority)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+
+    auto conn = pool.acquire();
+    auto now = SQLitePool::time_point::clock::now();
+
+    std::mutex mtx;
+    std::vector<std::string> order;
+    std::vector<std::thread> thr;
+
+    auto start = [&](std::string name, dbm::pool_priority priority, SQLitePool::time_point deadline) {
+        auto n = pool.stat().n_acquiring;
+        thr.emplace_back([&, name, priority, deadline] {
+            auto c = pool.acquire(priority, deadline);
+            std::lock_guard lock(mtx);
+            order.push_back(name);
+        });
+        BOOST_TEST(wait_for(pool, [n](auto& p) { return p.stat().n_acquiring == n + 1; }));
+    };
+
+    // served by priority class, then by deadline (no deadline - acquire timeout)
+    start("low1", dbm::pool_priority::low, SQLitePool::time_point::max());
+    start("low2", dbm::pool_priority::low, now + 1s);
+    start("normal1", dbm::pool_priority::normal, now + 4s);
+    start("normal2", dbm::pool_priority::normal, now + 3s);
+    start("high", dbm::pool_priority::high, SQLitePool::time_point::max());
+
+    conn.release();
+    for (auto& it : thr) {
+        it.join();
+    }
+
+    std::vector<std::string> expected {"high", "normal2", "normal1", "low2", "low1"};
+    BOOST_TEST(order == expected, boost::test_tools::per_element());
+
+    auto s = pool.stat();
+    BOOST_TEST(s.acquire_wait_priority[static_cast<size_t>(dbm::pool_priority::high)].count == 1);
+    BOOST_TEST(s.acquire_wait_priority[static_cast<size_t>(dbm::pool_priority::normal)].count == 3);
+    BOOST_TEST(s.acquire_wait_priority[static_cast<size_t>(dbm::pool_priority::low)].count == 2);
+    BOOST_TEST(pool.to_prometheus().find("dbm_pool_acquire_wait_priority_seconds_count{priority=\"low\"} 2\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(pool_acquire_deadline)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+    pool.set_acquire_timeout(5s);
+
+    // deadline shorter than acquire timeout
+    {
+        auto conn = pool.acquire();
+        auto tp = std::chrono::steady_clock::now();
+        BOOST_CHECK_THROW(pool.acquire(dbm::pool_priority::normal, tp + 200ms), std::exception);
+        auto dt = std::chrono::steady_clock::now() - tp;
+        BOOST_TEST((dt >= 200ms && dt < 1s));
+        BOOST_TEST(pool.stat().n_timeouts == 1);
+        std::this_thread::sleep_for(100ms);
+    }
+
+    // connection is held for 300 ms on average - shorter deadline is rejected immediately
+    {
+        auto conn = pool.acquire();
+        auto tp = std::chrono::steady_clock::now();
+        BOOST_CHECK_THROW(pool.acquire(dbm::pool_priority::normal, tp + 100ms), std::exception);
+        BOOST_TEST((std::chrono::steady_clock::now() - tp < 50ms));
+        BOOST_TEST(pool.stat().n_rejected == 1);
+
+        // expired deadline
+        BOOST_CHECK_THROW(pool.acquire(dbm::pool_priority::high, tp - 1ms), std::exception);
+        BOOST_TEST(pool.stat().n_rejected == 2);
+        BOOST_TEST(pool.stat().n_acquiring == 0);
+    }
+
+    // idle connection is returned regardless of deadline
+    auto conn = pool.acquire(dbm::pool_priority::low, std::chrono::steady_clock::now() + 1ms);
+    BOOST_TEST(conn.get().is_connected());
+}
+
+BOOST_AUTO_TEST_CASE(pool_adaptive_limit)
+{
+    SQLitePool pool;
+    pool.set_max_connections(4);
+
+    std::atomic<int> n_increased {0};
+    std::atomic<int> n_decreased {0};
+    pool.set_event_callback([&](dbm::pool_event event, SQLitePool::id_t) {
+        if (event == dbm::pool_event::limit_increased)
+            ++n_increased;
+        else if (event == dbm::pool_event::limit_decreased)
+            ++n_decreased;
+    }, false);
+
+    SQLitePool::adaptive_limit_options options;
+    options.enabled = true;
+    options.interval = 50ms;
+    options.target_wait = 1s;
+    pool.set_adaptive_limit(options);
+    BOOST_TEST(pool.connection_limit() == 1);
+
+    // waiting request raises the limit
+    {
+        auto conn1 = pool.acquire();
+        auto conn2 = pool.acquire();
+        BOOST_TEST(pool.connection_limit() == 2);
+        BOOST_TEST(pool.num_connections() == 2);
+        BOOST_TEST(n_increased == 1);
+        BOOST_TEST(pool.stat().n_limit_increased == 1);
+    }
+
+    // all connections in use, fast queries set the latency baseline
+    std::vector<SQLitePool::pool_connection_type> conns;
+    conns.push_back(pool.acquire());
+    conns.push_back(pool.acquire());
+    conns.push_back(pool.acquire());
+    conns.push_back(pool.acquire());
+    BOOST_TEST(pool.connection_limit() == 4);
+
+    auto& db = conns.front().get();
+    for (auto tp = std::chrono::steady_clock::now(); std::chrono::steady_clock::now() - tp < 300ms;) {
+        db.select("SELECT 1");
+    }
+
+    // slow queries - the database is considered saturated
+    for (auto tp = std::chrono::steady_clock::now(); !n_decreased && std::chrono::steady_clock::now() - tp < 3s;) {
+        db.select("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < 100000) SELECT count(*) FROM c");
+    }
+    BOOST_TEST(n_decreased > 0);
+    BOOST_TEST(pool.connection_limit() < 4);
+    BOOST_TEST(pool.stat().n_limit_decreased > 0);
+
+    // sessions above the limit are closed when released
+    conns.clear();
+    BOOST_TEST(pool.num_connections() <= pool.connection_limit());
+    BOOST_TEST(pool.stat().n_conn_limit == pool.connection_limit());
+    BOOST_TEST(pool.to_prometheus().find("dbm_pool_connection_limit " + std::to_string(pool.connection_limit()) + "\n") != std::string::npos);
+
+    // disabled - back to max connections
+    pool.set_adaptive_limit({});
+    BOOST_TEST(pool.connection_limit() == 4);
+}
+
+BOOST_AUTO_TEST_CASE(pool_queue_bound)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+    pool.set_max_acquiring(1);
+
+    std::vector<dbm::pool_event> events;
+    pool.set_event_callback([&events](dbm::pool_event event, SQLitePool::id_t) {
+        if (event == dbm::pool_event::queue_full)
+            events.push_back(event);
+    }, false);
+
+    auto conn = pool.acquire();
+    auto waiting = std::async(std::launch::async, [&pool] { return pool.acquire(); });
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.stat().n_acquiring == 1; }));
+
+    // queue is full - fails immediately
+    auto tp = std::chrono::steady_clock::now();
+    BOOST_CHECK_THROW(pool.acquire(), dbm::pool_queue_full_error);
+    BOOST_TEST((std::chrono::steady_clock::now() - tp < 50ms));
+    BOOST_TEST(pool.stat().n_queue_full == 1);
+    BOOST_TEST(events.size() == 1);
+
+    conn.release();
+    BOOST_TEST(waiting.get().get().is_connected());
+}
+
+BOOST_AUTO_TEST_CASE(pool_circuit_breaker)
+{
+    SlowSQLitePool pool;
+    pool.set_max_connections(1);
+    pool.set_circuit_breaker(2, 200ms);
+
+    std::mutex mtx;
+    std::vector<dbm::pool_event> events;
+    pool.set_event_callback([&](dbm::pool_event event, SlowSQLitePool::id_t) {
+        std::lock_guard lock(mtx);
+        events.push_back(event);
+    }, false);
+    auto has_event = [&](dbm::pool_event event) {
+        std::lock_guard lock(mtx);
+        return std::find(events.begin(), events.end(), event) != events.end();
+    };
+
+    // consecutive connect failures open the circuit
+    SlowSQLiteSession::down = true;
+    BOOST_CHECK_THROW(pool.acquire(), std::runtime_error);
+    BOOST_TEST((pool.circuit_state() == dbm::pool_circuit_state::closed));
+    BOOST_CHECK_THROW(pool.acquire(), std::runtime_error);
+    BOOST_TEST((pool.circuit_state() == dbm::pool_circuit_state::open));
+    BOOST_TEST(has_event(dbm::pool_event::circuit_opened));
+
+    // fail fast without connecting
+    SlowSQLiteSession::latency_ms = 500;
+    auto tp = std::chrono::steady_clock::now();
+    BOOST_CHECK_THROW(pool.acquire(), dbm::pool_circuit_open_error);
+    BOOST_TEST((std::chrono::steady_clock::now() - tp < 50ms));
+    BOOST_TEST(pool.stat().n_circuit_rejected == 1);
+    SlowSQLiteSession::latency_ms = 0;
+
+    // failed probe opens the circuit again
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.stat().n_circuit_opened == 2; }));
+    BOOST_TEST(has_event(dbm::pool_event::circuit_half_opened));
+
+    // successful probe closes the circuit and its session is kept idle
+    SlowSQLiteSession::down = false;
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.circuit_state() == dbm::pool_circuit_state::closed; }));
+    BOOST_TEST(has_event(dbm::pool_event::circuit_closed));
+    BOOST_TEST(pool.num_idle_connections() == 1);
+    BOOST_TEST(pool.to_prometheus().find("dbm_pool_circuit_opened_total 2\n") != std::string::npos);
+
+    // waiting requests fail when the circuit opens
+    auto conn = pool.acquire();
+    auto waiting1 = std::async(std::launch::async, [&pool] { return pool.acquire(); });
+    auto waiting2 = std::async(std::launch::async, [&pool] { return pool.acquire(); });
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.stat().n_acquiring == 2; }));
+
+    // released broken session hands its slot over, the connect fails again
+    pool.set_circuit_breaker(1, 10s);
+    SlowSQLiteSession::down = true;
+    conn.get().close();
+    conn.release();
+
+    BOOST_CHECK_THROW(waiting1.get(), std::exception);
+    tp = std::chrono::steady_clock::now();
+    BOOST_CHECK_THROW(waiting2.get(), std::exception);
+    BOOST_TEST((std::chrono::steady_clock::now() - tp < 1s));
+    BOOST_TEST((pool.circuit_state() == dbm::pool_circuit_state::open));
+    BOOST_TEST(pool.stat().n_acquiring == 0);
+    BOOST_TEST(pool.num_connections() == 0);
+
+    SlowSQLiteSession::down = false;
+    pool.set_circuit_breaker(0);
+    BOOST_TEST(pool.acquire().get().is_connected());
+}
+
+BOOST_AUTO_TEST_CASE(pool_submit)
+{
+    SQLitePool pool;
+    pool.set_max_connections(2);
+
+    // results are returned through futures
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++i) {
+        results.push_back(pool.submit([i](dbm::sqlite_session& s) {
+            return s.select("SELECT " + std::to_string(i)).at(0).at(0).get<int>();
+        }));
+    }
+    for (int i = 0; i < 100; ++i) {
+        BOOST_TEST(results[i].get() == i);
+    }
+    BOOST_TEST(pool.num_connections() <= 2);
+    BOOST_TEST(wait_for(pool, [](auto& p) { return p.stat().n_jobs_done == 100; }));
+    BOOST_TEST(pool.stat().n_jobs_queued == 0);
+
+    // void job, job exception
+    bool done = false;
+    pool.submit([&done](auto&) { done = true; }).get();
+    BOOST_TEST(done);
+    BOOST_CHECK_THROW(pool.submit([](dbm::sqlite_session& s) { return s.select("SELECT * FROM no_such_table").size(); }).get(),
+                      std::exception);
+
+    // number of jobs running at once is limited by connections
+    std::atomic<int> running {0};
+    std::atomic<int> running_max {0};
+    std::vector<std::future<void>> jobs;
+    for (int i = 0; i < 10; ++i) {
+        jobs.push_back(pool.submit([&](dbm::sqlite_session&) {
+            int n = ++running;
+            for (int prev = running_max; prev < n && !running_max.compare_exchange_weak(prev, n);) {
+            }
+            std::this_thread::sleep_for(10ms);
+            --running;
+        }));
+    }
+    for (auto& it : jobs) {
+        it.get();
+    }
+    BOOST_TEST(running_max <= 2);
+    jobs.clear();
+
+    // queue full while workers are busy
+    std::promise<void> gate;
+    auto gate_future = gate.get_future().share();
+    bool rejected = false;
+    for (size_t i = 0; i < 2 * SQLitePool::job_queue_size && !rejected; ++i) {
+        try {
+            jobs.push_back(pool.submit([gate_future](dbm::sqlite_session&) { gate_future.wait(); }));
+        }
+        catch (dbm::pool_queue_full_error&) {
+            rejected = true;
+        }
+    }
+    BOOST_TEST(rejected);
+    BOOST_TEST(pool.stat().n_jobs_rejected == 1);
+
+    gate.set_value();
+    for (auto& it : jobs) {
+        it.get();
+    }
+    BOOST_TEST(pool.stat().n_jobs_queued == 0);
+    jobs.clear();
+
+    // workers follow the connection limit - jobs waiting for each other need 3 at once
+    auto run_together = [&pool](int n) {
+        std::atomic<int> arrived {0};
+        std::vector<std::future<bool>> together;
+        for (int i = 0; i < n; ++i) {
+            together.push_back(pool.submit([&arrived, n](dbm::sqlite_session&) {
+                ++arrived;
+                auto until = std::chrono::steady_clock::now() + 2s;
+                while (arrived < n && std::chrono::steady_clock::now() < until) {
+                    std::this_thread::sleep_for(1ms);
+                }
+                return arrived == n;
+            }));
+        }
+        bool all = true;
+        for (auto& it : together) {
+            all = it.get() && all;
+        }
+        return all;
+    };
+    pool.set_max_connections(3);
+    BOOST_TEST(run_together(3));
+
+    // parked workers above a lowered limit
+    pool.set_max_connections(1);
+    running_max = 0;
+    for (int i = 0; i < 5; ++i) {
+        jobs.push_back(pool.submit([&](dbm::sqlite_session&) {
+            int n = ++running;
+            for (int prev = running_max; prev < n && !running_max.compare_exchange_weak(prev, n);) {
+            }
+            std::this_thread::sleep_for(5ms);
+            --running;
+        }));
+    }
+    for (auto& it : jobs) {
+        it.get();
+    }
+    BOOST_TEST(running_max == 1);
+}
+
+BOOST_AUTO_TEST_CASE(pool_affinity)
+{
+    SQLitePool pool;
+    pool.set_max_connections(4);
+
+    auto acquire_two = [&pool](auto acquire1, auto acquire2) {
+        auto c1 = acquire1();
+        auto c2 = acquire2();
+        return std::make_pair(&c1.get(), &c2.get()); // c1 is released last, so it is on top of the idle stack
+    };
+
+    // without affinity the most recently released session is reused
+    auto [s1, s2] = acquire_two([&] { return pool.acquire(); }, [&] { return pool.acquire(); });
+    BOOST_TEST(&pool.acquire().get() == s1);
+
+    // session last acquired with the same key is preferred
+    std::tie(s1, s2) = acquire_two([&] { return pool.acquire(1); }, [&] { return pool.acquire(2); });
+    BOOST_TEST(pool.stat().n_affinity_misses == 2);
+    for (int i = 0; i < 10; ++i) {
+        BOOST_TEST(&pool.acquire(1).get() == s1);
+        BOOST_TEST(&pool.acquire(2).get() == s2);
+    }
+    BOOST_TEST(pool.stat().n_affinity_hits == 20);
+
+    // busy preferred session - another one is used and remembered
+    {
+        auto c1 = pool.acquire(1);
+        auto c = pool.acquire();
+        BOOST_TEST(&c.get() == s2);
+        auto c2 = pool.acquire(2);
+        BOOST_TEST(&c2.get() != s1);
+        BOOST_TEST(&c2.get() != s2);
+        s2 = &c2.get();
+    }
+    BOOST_TEST(&pool.acquire(2).get() == s2);
+
+    // per thread affinity
+    pool.set_affinity(true);
+    pool.reset_stat();
+    std::promise<void> acquired, others_done;
+    std::thread thr([&] {
+        auto* thread_session = &pool.acquire().get();
+        acquired.set_value();
+        others_done.get_future().wait();
+
+        for (int i = 0; i < 10; ++i) {
+            BOOST_TEST(&pool.acquire().get() == thread_session);
+        }
+    });
+
+    // other sessions are released after the thread session
+    acquired.get_future().wait();
+    acquire_two([&] { return pool.acquire(1); }, [&] { return pool.acquire(2); });
+    others_done.set_value();
+    thr.join();
+    BOOST_TEST(pool.stat().n_affinity_hits == 12);
+    BOOST_TEST(pool.stat().affinity_hit_rate() > 0.9);
+    BOOST_TEST(pool.to_prometheus().find("dbm_pool_affinity_hits_total 12\n") != std::string::npos);
+
+    // concurrent preferred and plain acquires keep the idle stack consistent
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool, t] {
+            for (int i = 0; i < 500; ++i) {
+                auto conn = i % 3 ? pool.acquire(t) : pool.acquire();
+                conn.get().select("SELECT 1");
+            }
+        });
+    }
+    for (auto& it : threads) {
+        it.join();
+    }
+    BOOST_TEST(pool.num_connections() <= 4);
+    BOOST_TEST(pool.num_idle_connections() == pool.num_connections());
+    std::set<dbm::sqlite_session*> idle;
+    std::vector<SQLitePool::pool_connection_type> conns;
+    for (size_t i = 0; i < pool.num_connections(); ++i) {
+        conns.push_back(pool.acquire());
+        idle.insert(&conns.back().get());
+    }
+    BOOST_TEST(idle.size() == conns.size());
+}
+
+BOOST_AUTO_TEST_CASE(pool_statement_registry)
+{
+    SQLitePool pool;
+    pool.set_max_connections(2);
+
+    auto id = pool.register_statement("SELECT 42");
+    BOOST_REQUIRE_THROW(pool.make_statement(id + 1), std::out_of_range);
+
+    auto is_prepared = [](dbm::sqlite_session& s, std::string const& stmt) {
+        return s.prepared_statement_handles().count(stmt) == 1;
+    };
+
+    // prepared on connect
+    auto c1 = pool.acquire();
+    auto c2 = pool.acquire();
+    BOOST_TEST(is_prepared(c1.get(), "SELECT 42"));
+    BOOST_TEST(is_prepared(c2.get(), "SELECT 42"));
+
+    // the same statement runs on both sessions with their own handles
+    auto stmt = pool.make_statement(id, dbm::local<int>());
+    BOOST_TEST(stmt.slot() == id);
+    for (auto* s : {&c1.get(), &c2.get(), &c1.get()}) {
+        auto rows = s->select(stmt);
+        BOOST_TEST(rows.size() == 1);
+        BOOST_TEST(rows.at(0).at(0)->get<int>() == 42);
+        BOOST_TEST(stmt.native_handle() == s->prepared_statement_handles().at("SELECT 42"));
+    }
+
+    // active session prepares on first use
+    c2.release();
+    auto id2 = pool.register_statement("SELECT 43");
+    BOOST_TEST(!is_prepared(c1.get(), "SELECT 43"));
+    auto stmt2 = pool.make_statement(id2, dbm::local<int>());
+    BOOST_TEST(c1.get().select(stmt2).at(0).at(0)->get<int>() == 43);
+    BOOST_TEST(is_prepared(c1.get(), "SELECT 43"));
+    c1.release();
+
+    // idle sessions prepare in the background
+    pool.register_statement("SELECT 44");
+    BOOST_TEST(wait_for(pool, [&](auto&) {
+        auto conn1 = pool.acquire();
+        auto conn2 = pool.acquire();
+        return is_prepared(conn1.get(), "SELECT 44") && is_prepared(conn2.get(), "SELECT 44");
+    }));
+    BOOST_TEST(pool.num_connections() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(pool_latency_stats)
+{
+    SQLitePool pool;
+    pool.set_max_connections(1);
+
+    {
+        auto conn = pool.acquire();
+        conn.get().query("SELECT 1");
+        std::this_thread::sleep_for(20ms);
+    }
+
+    // second acquire waits for the connection held by the other thread
+    std::promise<void> acquired;
+    std::thread holder([&] {
+        auto conn = pool.acquire();
+        acquired.set_value();
+        std::this_thread::sleep_for(50ms);
+    });
+    acquired.get_future().wait();
+    {
+        auto conn = pool.acquire();
+    }
+    holder.join();
+
+    auto s = pool.stat();
+    BOOST_TEST(s.acquire_wait.count == 3);
+    BOOST_TEST((s.acquire_wait.max >= 30ms));
+    BOOST_TEST(s.hold_time.count == 3);
+    BOOST_TEST((s.hold_time.max >= 50ms));
+    BOOST_TEST((s.hold_time.percentile(0.5) >= 20ms));
+    BOOST_TEST(s.query_time.count == 1);
+
+    size_t n = 0;
+    for (auto const& [ms, cnt] : s.acquire_stat) {
+        n += cnt;
+    }
+    BOOST_TEST(n == 3);
+
+    auto text = pool.to_prometheus("dbm_pool", "pool=\"test\"");
+    BOOST_TEST(text.find("dbm_pool_connections{pool=\"test\"} 1\n") != std::string::npos);
+    BOOST_TEST(text.find("dbm_pool_acquired_total{pool=\"test\"} 3\n") != std::string::npos);
+    BOOST_TEST(text.find("dbm_pool_acquire_wait_seconds_count{pool=\"test\"} 3\n") != std::string::npos);
+    BOOST_TEST(text.find("dbm_pool_hold_seconds_count{pool=\"test\"} 3\n") != std::string::npos);
+    BOOST_TEST(text.find("dbm_pool_query_seconds_count{pool=\"test\"} 1\n") != std::string::npos);
+
+    pool.reset_stat();
+    BOOST_TEST(pool.stat().acquire_wait.count == 0);
+    BOOST_TEST(pool.stat().hold_time.count == 0);
+    BOOST_TEST(pool.stat().query_time.count == 0);
+}
+
 class MultipleWriters
 {
     SQLitePool pool_;
@@ -178,6 +1139,194 @@ BOOST_AUTO_TEST_CASE(pool_multiple_threads)
     test.run();
 }
 
+class SingleWriterMultiReader
+{
+    static constexpr const char* db_file_name_ = "dbm_test_swmr.sqlite3";
+    static constexpr unsigned n_writers_ {8};
+    static constexpr unsigned n_readers_ {4};
+    static constexpr unsigned n_rec_ {100};
+
+    std::unique_ptr<dbm::sqlite_pool> pool_;
+    std::atomic<size_t> num_exceptions_ {0};
+    std::atomic<size_t> num_reads_ {0};
+
+public:
+    SingleWriterMultiReader()
+    {
+        remove_sqlite_files(db_file_name_);
+        pool_ = std::make_unique<dbm::sqlite_pool>(db_file_name_, n_readers_);
+        pool_->set_acquire_timeout(20s);
+
+        auto m = get_model();
+        pool_->query("DROP TABLE IF EXISTS test_pool_swmr");
+        m.create_table(*pool_->acquire_writer());
+    }
+
+    ~SingleWriterMultiReader()
+    {
+        pool_.reset();
+        remove_sqlite_files(db_file_name_);
+    }
+
+    static dbm::model get_model()
+    {
+        return dbm::model ("test_pool_swmr",
+                          {
+                              { dbm::key("id"), dbm::local<int>(), dbm::primary(true), dbm::not_null(true) },
+                              { dbm::key("thread_id"), dbm::local<int>() },
+                              { dbm::key("value"), dbm::local<int>() }
+                          });
+    }
+
+    void run()
+    {
+        std::vector<std::thread> thr;
+        std::atomic<bool> writing {true};
+
+        for (auto i = 0u; i < n_writers_; ++i) {
+            thr.emplace_back([this, i] { writer(i); });
+        }
+
+        std::vector<std::thread> readers;
+        for (auto i = 0u; i < n_readers_; ++i) {
+            readers.emplace_back([this, &writing] {
+                while (writing) {
+                    reader();
+                }
+            });
+        }
+
+        for (auto& it : thr) {
+            it.join();
+        }
+
+        writing = false;
+        for (auto& it : readers) {
+            it.join();
+        }
+
+        BOOST_TEST(num_exceptions_ == 0);
+        BOOST_TEST(num_reads_ > 0);
+        BOOST_TEST(pool_->writer_pool().num_connections() == 1);
+        BOOST_TEST(pool_->reader_pool().num_connections() <= n_readers_);
+
+        auto rows = pool_->select("SELECT COUNT(*) FROM test_pool_swmr");
+        BOOST_TEST(rows.at(0).at(0).get<unsigned>() == n_writers_ * n_rec_);
+
+        // model read is routed to a reader
+        auto m = get_model();
+        m.at("id").set_value(1);
+        pool_->read_record(m);
+        BOOST_TEST(m.at("value").value<int>() == 1);
+
+        // readers are query only
+        BOOST_REQUIRE_THROW(pool_->acquire_reader().get().query("DELETE FROM test_pool_swmr"), std::exception);
+    }
+
+    void writer(unsigned thread_id)
+    {
+        try {
+            auto m = get_model();
+
+            for (auto i = thread_id * n_rec_; i < (thread_id + 1) * n_rec_; ++i) {
+                m.at("id").set_value(static_cast<int>(i + 1));
+                m.at("thread_id").set_value(static_cast<int>(thread_id));
+                m.at("value").set_value(static_cast<int>(i + 1));
+                pool_->write_record(m);
+            }
+        }
+        catch (std::exception& e) {
+            ++num_exceptions_;
+            BOOST_TEST_MESSAGE("Writer exception : " << e.what());
+        }
+    }
+
+    void reader()
+    {
+        try {
+            auto conn = pool_->acquire_reader();
+            auto rows = conn.get().select("SELECT COUNT(*) FROM test_pool_swmr");
+            BOOST_TEST(rows.size() == 1);
+            ++num_reads_;
+        }
+        catch (std::exception& e) {
+            ++num_exceptions_;
+            BOOST_TEST_MESSAGE("Reader exception : " << e.what());
+        }
+    }
+};
+
+BOOST_AUTO_TEST_CASE(pool_single_writer_multi_reader)
+{
+    SingleWriterMultiReader test;
+    test.run();
+}
+
+BOOST_AUTO_TEST_CASE(sqlite_pool_prepared_statement)
+{
+    std::string const db_file_name = "dbm_test_swmr_stmt.sqlite3";
+    remove_sqlite_files(db_file_name);
+
+    {
+        dbm::sqlite_pool pool(db_file_name, 2);
+        dbm::kind::prepared_statement stmt("SELECT 42", dbm::local<int>());
+
+        auto r1 = pool.acquire_reader();
+        auto r2 = pool.acquire_reader();
+        auto* s1 = &r1.get();
+        auto* s2 = &r2.get();
+        BOOST_TEST(s1->select(stmt).at(0).at(0)->get<int>() == 42);
+        BOOST_TEST(stmt.native_handle() == s1->prepared_statement_handles().at("SELECT 42"));
+
+        // statement prepared by the first reader is prepared again by the second one
+        r2.release();
+        BOOST_TEST(pool.select(stmt).at(0).at(0)->get<int>() == 42);
+        BOOST_TEST(stmt.native_handle() == s2->prepared_statement_handles().at("SELECT 42"));
+        BOOST_TEST(s1->prepared_statement_handles().at("SELECT 42") != s2->prepared_statement_handles().at("SELECT 42"));
+
+        // and back on the other reader
+        r1.release();
+        r2 = pool.acquire_reader();
+        auto* other = &r2.get() == s1 ? s2 : s1;
+        BOOST_TEST(pool.select(stmt).at(0).at(0)->get<int>() == 42);
+        BOOST_TEST(stmt.native_handle() == other->prepared_statement_handles().at("SELECT 42"));
+    }
+
+    remove_sqlite_files(db_file_name);
+}
+
+BOOST_AUTO_TEST_CASE(sqlite_pool_statement_registries)
+{
+    std::string const db_file_name = "dbm_test_swmr_reg.sqlite3";
+    remove_sqlite_files(db_file_name);
+
+    {
+        dbm::sqlite_pool pool(db_file_name, 1);
+
+        // both registries number their statements from 0
+        auto wid = pool.writer_pool().register_statement("SELECT 1");
+        auto rid = pool.reader_pool().register_statement("SELECT 2");
+        BOOST_TEST(wid == rid);
+
+        auto wstmt = pool.writer_pool().make_statement(wid, dbm::local<int>());
+        auto rstmt = pool.reader_pool().make_statement(rid, dbm::local<int>());
+
+        auto reader = pool.acquire_reader();
+        auto writer = pool.acquire_writer();
+        for (auto* s : {&reader.get(), &writer.get(), &reader.get(), &writer.get()}) {
+            BOOST_TEST(s->select(wstmt).at(0).at(0)->get<int>() == 1);
+            BOOST_TEST(s->select(rstmt).at(0).at(0)->get<int>() == 2);
+        }
+        reader.release();
+        writer.release();
+
+        BOOST_TEST(pool.select(wstmt).at(0).at(0)->get<int>() == 1);
+        BOOST_TEST(pool.select(rstmt).at(0).at(0)->get<int>() == 2);
+    }
+
+    remove_sqlite_files(db_file_name);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif
\ No newline at end of file